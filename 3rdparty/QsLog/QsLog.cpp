@@ -26,8 +26,9 @@
 #include "QsLog.h"
 #include "QsLogDest.h"
 #ifdef QS_LOG_SEPARATE_THREAD
-#include <QThreadPool>
-#include <QRunnable>
+#include <QThread>
+#include <QSemaphore>
+#include <QAtomicPointer>
 #else
 #include <QMutex>
 #endif
@@ -76,50 +77,194 @@ static const char* LevelToText(Level theLevel)
     }
 }
 
+//! builds the complete log message : level, local time, text
+static QString FormatMessage(const QString& text, Level level, qint64 time)
+{
+    const QString levelName = QString::fromLatin1(LevelToText(level));
+    QString message;
+    message.reserve(30 + text.size());
+    message.append(levelName.rightJustified(5));
+    message.append(QLatin1Char(' '));
+    message.append(QDateTime::fromMSecsSinceEpoch(time).toString(fmtDateTime));
+    message.append(QLatin1Char(' '));
+    message.append(text);
+    return message;
+}
+
 #ifdef QS_LOG_SEPARATE_THREAD
-class LogWriterRunnable : public QRunnable
+struct LogMessage
+{
+    QAtomicPointer<LogMessage> next;
+    Level level;
+    qint64 time;
+    QString text;
+};
+
+//! Intrusive multiple producer, single consumer queue (D. Vyukov). push
+//! is one atomic exchange, no locks : the logging threads never wait for
+//! each other or for the writer.
+class LogQueue
 {
 public:
-    LogWriterRunnable(const QString &message, Level level)
-        : mMessage(message)
-        , mLevel(level) {}
+    LogQueue() :
+        mHead(&mStub),
+        mTail(&mStub)
+    {
+        mStub.next.storeRelease(NULL);
+    }
+
+    //! any thread
+    void push(LogMessage *message)
+    {
+        message->next.storeRelease(NULL);
+        LogMessage *prev = mHead.fetchAndStoreOrdered(message);
+        prev->next.storeRelease(message);
+    }
+
+    //! writer thread only. Null when empty, or when a push is half done
+    LogMessage *pop()
+    {
+        LogMessage *tail = mTail;
+        LogMessage *next = tail->next.loadAcquire();
+        if (tail == &mStub) {
+            if (!next)
+                return NULL;
+            mTail = next;
+            tail = next;
+            next = next->next.loadAcquire();
+        }
+        if (next) {
+            mTail = next;
+            return tail;
+        }
+        if (tail != mHead.loadAcquire())
+            return NULL;
+        push(&mStub);
+        next = tail->next.loadAcquire();
+        if (next) {
+            mTail = next;
+            return tail;
+        }
+        return NULL;
+    }
 
+    //! writer thread only
+    bool isEmpty()
+    {
+        return mTail == &mStub && mHead.loadAcquire() == &mStub;
+    }
+
+private:
+    LogMessage mStub;
+    QAtomicPointer<LogMessage> mHead; // last pushed
+    LogMessage *mTail; // next to pop
+};
+
+//! Formats and writes the queued messages. Each wake up writes all the
+//! messages queued meanwhile, the destinations are flushed once per batch.
+class LogWriterThread : public QThread
+{
+public:
+    explicit LogWriterThread(Logger *logger) :
+        mLogger(logger),
+        mIdle(0),
+        mStop(0) {}
+
+    enum {MaxBatch = 256, IdleTimeout = 100}; // messages, ms
+
+    //! any thread
+    void enqueue(LogMessage *message)
+    {
+        mQueue.push(message);
+        // wake the writer only if it sleeps - one semaphore call per batch
+        if (mIdle.loadAcquire() && mIdle.testAndSetOrdered(1, 0))
+            mWake.release();
+    }
+
+    void stop()
+    {
+        mStop.storeRelease(1);
+        mWake.release();
+        wait();
+    }
+
+protected:
     virtual void run()
     {
-        Logger::instance().write(mMessage, mLevel);
+        for (;;) {
+            int batch = 0;
+            while (LogMessage *message = mQueue.pop()) {
+                mLogger->write(FormatMessage(message->text, message->level, message->time),
+                               message->level);
+                delete message;
+                if (++batch == MaxBatch) {
+                    mLogger->flush();
+                    batch = 0;
+                }
+            }
+            if (batch)
+                mLogger->flush();
+
+            if (!mQueue.isEmpty()) {
+                // a push is half done
+                yieldCurrentThread();
+                continue;
+            }
+            if (mStop.loadAcquire())
+                break;
+
+            // the queue is checked again after the flag is set : a message
+            // pushed meanwhile either sees the flag or is found here
+            mIdle.fetchAndStoreOrdered(1);
+            if (mQueue.isEmpty())
+                mWake.tryAcquire(1, IdleTimeout);
+            mIdle.fetchAndStoreOrdered(0);
+        }
     }
 
 private:
-    QString mMessage;
-    Level mLevel;
+    Logger *mLogger;
+    LogQueue mQueue;
+    QSemaphore mWake;
+    QAtomicInt mIdle;
+    QAtomicInt mStop;
 };
 #endif
 
 class LoggerImpl
 {
 public:
-    LoggerImpl() :
-        level(InfoLevel)
+    explicit LoggerImpl(Logger *logger)
+#ifdef QS_LOG_SEPARATE_THREAD
+        : writer(logger)
+#endif
     {
+        Q_UNUSED(logger);
         // assume at least file + console
         destList.reserve(2);
+    }
+    ~LoggerImpl()
+    {
 #ifdef QS_LOG_SEPARATE_THREAD
-        threadPool.setMaxThreadCount(1);
-        threadPool.setExpiryTimeout(-1);
+        // write what is still queued
+        writer.stop();
 #endif
     }
 #ifdef QS_LOG_SEPARATE_THREAD
-    QThreadPool threadPool;
+    LogWriterThread writer;
 #else
     QMutex logMutex;
 #endif
-    Level level;
     DestinationList destList;
 };
 
 Logger::Logger() :
-    d(new LoggerImpl)
+    mLevel(InfoLevel),
+    d(new LoggerImpl(this))
 {
+#ifdef QS_LOG_SEPARATE_THREAD
+    d->writer.start();
+#endif
 }
 
 Logger::~Logger()
@@ -135,25 +280,20 @@ void Logger::addDestination(DestinationPtr destination)
 
 void Logger::setLoggingLevel(Level newLevel)
 {
-    d->level = newLevel;
+    mLevel.storeRelease(newLevel);
 }
 
-Level Logger::loggingLevel() const
+Logger::Helper::Helper(Level logLevel) :
+    level(logLevel),
+    time(QDateTime::currentMSecsSinceEpoch()),
+    qtDebug(&buffer)
 {
-    return d->level;
 }
 
-//! creates the complete log message and passes it to the logger
+//! passes the message to the logger, the time is formatted when written
 void Logger::Helper::writeToLog()
 {
-    const char* const levelName = LevelToText(level);
-    const QString completeMessage(QString("%1 %2 %3")
-                                  .arg(levelName, 5)
-                                  .arg(QDateTime::currentDateTime().toString(fmtDateTime))
-                                  .arg(buffer)
-                                  );
-
-    Logger::instance().enqueueWrite(completeMessage, level);
+    Logger::instance().enqueueWrite(buffer, level, time);
 }
 
 Logger::Helper::~Helper()
@@ -168,15 +308,19 @@ Logger::Helper::~Helper()
     }
 }
 
-//! directs the message to the task queue or writes it directly
-void Logger::enqueueWrite(const QString& message, Level level)
+//! directs the message to the writer thread queue or writes it directly
+void Logger::enqueueWrite(const QString& message, Level level, qint64 time)
 {
 #ifdef QS_LOG_SEPARATE_THREAD
-    LogWriterRunnable *r = new LogWriterRunnable(message, level);
-    d->threadPool.start(r);
+    LogMessage *m = new LogMessage;
+    m->level = level;
+    m->time = time;
+    m->text = message;
+    d->writer.enqueue(m);
 #else
     QMutexLocker lock(&d->logMutex);
-    write(message, level);
+    write(FormatMessage(message, level, time), level);
+    flush();
 #endif
 }
 
@@ -190,4 +334,13 @@ void Logger::write(const QString& message, Level level)
     }
 }
 
+//! Ends a batch of writes
+void Logger::flush()
+{
+    for (DestinationList::iterator it = d->destList.begin(),
+        endIt = d->destList.end();it != endIt;++it) {
+        (*it)->flush();
+    }
+}
+
 } // end namespace
@@ -30,6 +30,7 @@
 #include "QsLogDest.h"
 #include <QDebug>
 #include <QString>
+#include <QAtomicInt>
 
 #define QS_LOG_VERSION "2.0b1"
 
@@ -51,17 +52,19 @@ public:
     void addDestination(DestinationPtr destination);
     //! Logging at a level < 'newLevel' will be ignored
     void setLoggingLevel(Level newLevel);
-    //! The default level is INFO
-    Level loggingLevel() const;
+    //! The default level is INFO. Inline : checked by the macros before
+    //! any message is built
+    Level loggingLevel() const
+    {
+        return static_cast<Level>(mLevel.loadAcquire());
+    }
 
     //! The helper forwards the streaming to QDebug and builds the final
     //! log message.
     class Helper
     {
     public:
-        explicit Helper(Level logLevel) :
-            level(logLevel),
-            qtDebug(&buffer) {}
+        explicit Helper(Level logLevel);
         ~Helper();
         QDebug& stream(){ return qtDebug; }
 
@@ -69,6 +72,7 @@ public:
         void writeToLog();
 
         Level level;
+        qint64 time;
         QString buffer;
         QDebug qtDebug;
     };
@@ -79,12 +83,14 @@ private:
     Logger& operator=(const Logger&);
     ~Logger();
 
-    void enqueueWrite(const QString& message, Level level);
+    void enqueueWrite(const QString& message, Level level, qint64 time);
     void write(const QString& message, Level level);
+    void flush();
 
+    QAtomicInt mLevel;
     LoggerImpl* d;
 
-    friend class LogWriterRunnable;
+    friend class LogWriterThread;
 };
 
 } // end namespace
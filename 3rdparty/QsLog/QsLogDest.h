@@ -40,6 +40,7 @@ public:
     virtual ~Destination(){}
     virtual void write(const QString& message, Level level) = 0;
     virtual bool isValid() = 0; // returns whether the destination was created correctly
+    virtual void flush() {} // called after each batch of writes
 };
 typedef QSharedPointer<Destination> DestinationPtr;
 
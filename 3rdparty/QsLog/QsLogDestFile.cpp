@@ -144,7 +144,12 @@ void QsLogging::FileDestination::write(const QString& message, Level)
         mOutputStream.setDevice(&mFile);
     }
 
-    mOutputStream << message << endl;
+    // buffered, the logger flushes once per batch of messages
+    mOutputStream << message << '\n';
+}
+
+void QsLogging::FileDestination::flush()
+{
     mOutputStream.flush();
 }
 
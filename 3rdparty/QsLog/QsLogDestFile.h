@@ -89,6 +89,7 @@ public:
     FileDestination(const QString& filePath, RotationStrategyPtr rotationStrategy);
     virtual void write(const QString& message, Level level);
     virtual bool isValid();
+    virtual void flush();
 
 private:
     QFile mFile;
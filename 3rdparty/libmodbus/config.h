@@ -6,11 +6,20 @@
 
 /* Define to 1 if you have the declaration of `TIOCSRS485', and to 0 if you
    don't. */
+//***Not part of libmodbus - added for QModMaster***//
+#if defined(__linux__)
+#define HAVE_DECL_TIOCSRS485 1
+#else
 #define HAVE_DECL_TIOCSRS485 0
+#endif
 
 /* Define to 1 if you have the declaration of `TIOCM_RTS', and to 0 if you
    don't. */
+#if defined(__linux__)
+#define HAVE_DECL_TIOCM_RTS 1
+#else
 #define HAVE_DECL_TIOCM_RTS 0
+#endif
 
 /* Define to 1 if you have the declaration of `__CYGWIN__', and to 0 if you
    don't. */
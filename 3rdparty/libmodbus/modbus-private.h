@@ -85,10 +85,15 @@ typedef struct _modbus_backend {
     int (*connect) (modbus_t *ctx);
     void (*close) (modbus_t *ctx);
     int (*flush) (modbus_t *ctx);
-    int (*select) (modbus_t *ctx, fd_set *rset, struct timeval *tv, int msg_length);
+    int (*select) (modbus_t *ctx, struct timeval *tv, int msg_length);
     void (*free) (modbus_t *ctx);
 } modbus_backend_t;
 
+/* Not part of libmodbus - added for QModMaster.
+   Bytes are read from the link in blocks, the bytes read ahead of the frame
+   being parsed are kept for the next frame (pipelined TCP responses). */
+#define _MODBUS_RX_BUFFER_LENGTH 1024
+
 struct _modbus {
     /* Slave address */
     int slave;
@@ -100,9 +105,16 @@ struct _modbus {
     struct timeval byte_timeout;
     const modbus_backend_t *backend;
     void *backend_data;
+    uint8_t rx_buffer[_MODBUS_RX_BUFFER_LENGTH];
+    int rx_start;
+    int rx_end;
 };
 
 void _modbus_init_common(modbus_t *ctx);
+void _modbus_clear_rx_buffer(modbus_t *ctx);
+#ifndef _WIN32
+int _modbus_poll(modbus_t *ctx, short events, struct timeval *tv);
+#endif
 void _error_print(modbus_t *ctx, const char *context);
 int _modbus_receive_msg(modbus_t *ctx, uint8_t *msg, msg_type_t msg_type);
 
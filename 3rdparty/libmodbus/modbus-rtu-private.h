@@ -17,6 +17,7 @@
 #include <windows.h>
 #else
 #include <termios.h>
+#include <time.h>
 #endif
 
 #define _MODBUS_RTU_HEADER_LENGTH      1
@@ -69,6 +70,14 @@ typedef struct _modbus_rtu {
     int rts_delay;
     int onebyte_time;
     void (*set_rts) (modbus_t *ctx, int on);
+#endif
+//***Not part of libmodbus - added for QModMaster***//
+#if !defined(_WIN32)
+    /* Time to send one character and the silent interval between frames (us) */
+    int char_time;
+    int t35_time;
+    /* End of the last character sent or received on the bus */
+    struct timespec last_activity;
 #endif
     /* To handle many slaves on the same link */
     int confirmation_to_ignore;
@@ -38,6 +38,9 @@ MODBUS_API int modbus_rtu_set_custom_rts(modbus_t *ctx, void (*set_rts) (modbus_
 MODBUS_API int modbus_rtu_set_rts_delay(modbus_t *ctx, int us);
 MODBUS_API int modbus_rtu_get_rts_delay(modbus_t *ctx);
 
+//***Not part of libmodbus - added for QModMaster***//
+MODBUS_API uint16_t modbus_rtu_crc16(const uint8_t *buffer, int length);
+
 MODBUS_END_DECLS
 
 #endif /* MODBUS_RTU_H */
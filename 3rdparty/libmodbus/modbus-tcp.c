@@ -29,6 +29,7 @@
 #else
 # include <sys/socket.h>
 # include <sys/ioctl.h>
+# include <poll.h>
 
 #if defined(__OpenBSD__) || (defined(__FreeBSD__) && __FreeBSD__ < 5)
 # define OS_BSD
@@ -270,15 +271,27 @@ static int _connect(int sockfd, const struct sockaddr *addr, socklen_t addrlen,
 #else
     if (rc == -1 && errno == EINPROGRESS) {
 #endif
-        fd_set wset;
         int optval;
         socklen_t optlen = sizeof(optval);
         struct timeval tv = *ro_tv;
+#ifdef OS_WIN32
+        fd_set wset;
 
         /* Wait to be available in writing */
         FD_ZERO(&wset);
         FD_SET(sockfd, &wset);
         rc = select(sockfd + 1, NULL, &wset, NULL, &tv);
+#else
+        struct pollfd pfd;
+
+        /* Wait to be available in writing */
+        pfd.fd = sockfd;
+        pfd.events = POLLOUT;
+        pfd.revents = 0;
+        do {
+            rc = poll(&pfd, 1, tv.tv_sec * 1000 + (tv.tv_usec + 999) / 1000);
+        } while (rc == -1 && errno == EINTR);
+#endif
         if (rc <= 0) {
             /* Timeout or fail */
             return -1;
@@ -659,6 +672,7 @@ int modbus_tcp_accept(modbus_t *ctx, int *s)
 #else
     ctx->s = accept(*s, (struct sockaddr *)&addr, &addrlen);
 #endif
+    _modbus_clear_rx_buffer(ctx);
 
     if (ctx->s == -1) {
         close(*s);
@@ -691,6 +705,7 @@ int modbus_tcp_pi_accept(modbus_t *ctx, int *s)
 #else
     ctx->s = accept(*s, (struct sockaddr *)&addr, &addrlen);
 #endif
+    _modbus_clear_rx_buffer(ctx);
     if (ctx->s == -1) {
         close(*s);
         *s = -1;
@@ -703,17 +718,22 @@ int modbus_tcp_pi_accept(modbus_t *ctx, int *s)
     return ctx->s;
 }
 
-static int _modbus_tcp_select(modbus_t *ctx, fd_set *rset, struct timeval *tv, int length_to_read)
+static int _modbus_tcp_select(modbus_t *ctx, struct timeval *tv, int length_to_read)
 {
+#ifdef OS_WIN32
     int s_rc;
-    while ((s_rc = select(ctx->s+1, rset, NULL, NULL, tv)) == -1) {
+    fd_set rset;
+
+    FD_ZERO(&rset);
+    FD_SET(ctx->s, &rset);
+    while ((s_rc = select(ctx->s+1, &rset, NULL, NULL, tv)) == -1) {
         if (errno == EINTR) {
             if (ctx->debug) {
                 fprintf(stderr, "A non blocked signal was caught\n");
             }
             /* Necessary after an error */
-            FD_ZERO(rset);
-            FD_SET(ctx->s, rset);
+            FD_ZERO(&rset);
+            FD_SET(ctx->s, &rset);
         } else {
             return -1;
         }
@@ -725,6 +745,9 @@ static int _modbus_tcp_select(modbus_t *ctx, fd_set *rset, struct timeval *tv, i
     }
 
     return s_rc;
+#else
+    return _modbus_poll(ctx, POLLIN, tv);
+#endif
 }
 
 static void _modbus_tcp_free(modbus_t *ctx) {
@@ -17,12 +17,21 @@
 #ifndef _MSC_VER
 #include <unistd.h>
 #endif
+#ifndef _WIN32
+#include <poll.h>
+#endif
 
 #include <config.h>
 
 #include "modbus.h"
 #include "modbus-private.h"
 
+//***Not part of libmodbus - added for QModMaster***//
+/* Bus monitor hooks, implemented by the application */
+void busMonitorRawRequestData(uint8_t *data, int dataLen);
+void busMonitorRawResponseData(uint8_t *data, int dataLen);
+void busMonitorRawResponseStart(void);
+
 /* Internal use */
 #define MSG_LENGTH_UNDEFINED -1
 
@@ -117,6 +126,7 @@ int modbus_flush(modbus_t *ctx)
         return -1;
     }
 
+    _modbus_clear_rx_buffer(ctx);
     rc = ctx->backend->flush(ctx);
     if (rc != -1 && ctx->debug) {
         /* Not all backends are able to return the number of bytes flushed */
@@ -211,6 +221,16 @@ static int send_msg(modbus_t *ctx, uint8_t *msg, int msg_length)
 }
 
 int modbus_send_raw_request(modbus_t *ctx, uint8_t *raw_req, int raw_req_length)
+{
+    return modbus_send_raw_request_tid(ctx, raw_req, raw_req_length, 0);
+}
+
+//***Not part of libmodbus - added for QModMaster***//
+/* Same as modbus_send_raw_request with the transaction id of the MBAP header
+   (TCP only, ignored by RTU). Several requests may be outstanding, the
+   responses are read with modbus_receive_confirmation and matched with
+   modbus_check_confirmation. */
+int modbus_send_raw_request_tid(modbus_t *ctx, uint8_t *raw_req, int raw_req_length, int tid)
 {
     sft_t sft;
     uint8_t req[MAX_MESSAGE_LENGTH];
@@ -231,8 +251,7 @@ int modbus_send_raw_request(modbus_t *ctx, uint8_t *raw_req, int raw_req_length)
 
     sft.slave = raw_req[0];
     sft.function = raw_req[1];
-    /* The t_id is left to zero */
-    sft.t_id = 0;
+    sft.t_id = tid;
     /* This response function only set the header so it's convenient here */
     req_length = ctx->backend->build_response_basis(&sft, req);
 
@@ -343,7 +362,6 @@ static int compute_data_length_after_meta(modbus_t *ctx, uint8_t *msg,
 int _modbus_receive_msg(modbus_t *ctx, uint8_t *msg, msg_type_t msg_type)
 {
     int rc;
-    fd_set rset;
     struct timeval tv;
     struct timeval *p_tv;
     int length_to_read;
@@ -358,10 +376,6 @@ int _modbus_receive_msg(modbus_t *ctx, uint8_t *msg, msg_type_t msg_type)
         }
     }
 
-    /* Add a file descriptor to the set */
-    FD_ZERO(&rset);
-    FD_SET(ctx->s, &rset);
-
     /* We need to analyse the message step by step.  At the first step, we want
      * to reach the function code because all packets contain this
      * information. */
@@ -379,7 +393,10 @@ int _modbus_receive_msg(modbus_t *ctx, uint8_t *msg, msg_type_t msg_type)
     }
 
     while (length_to_read != 0) {
-        rc = ctx->backend->select(ctx, &rset, p_tv, length_to_read);
+      //***Not part of libmodbus - added for QModMaster***//
+      /* Wait and read a block only when the receive buffer is empty */
+      if (ctx->rx_start == ctx->rx_end) {
+        rc = ctx->backend->select(ctx, p_tv, length_to_read);
         if (rc == -1) {
             _error_print(ctx, "select");
             if (ctx->error_recovery & MODBUS_ERROR_RECOVERY_LINK) {
@@ -397,7 +414,7 @@ int _modbus_receive_msg(modbus_t *ctx, uint8_t *msg, msg_type_t msg_type)
             return -1;
         }
 
-        rc = ctx->backend->recv(ctx, msg + msg_length, length_to_read);
+        rc = ctx->backend->recv(ctx, ctx->rx_buffer, _MODBUS_RX_BUFFER_LENGTH);
         if (rc == 0) {
             errno = ECONNRESET;
             rc = -1;
@@ -417,6 +434,22 @@ int _modbus_receive_msg(modbus_t *ctx, uint8_t *msg, msg_type_t msg_type)
             return -1;
         }
 
+        ctx->rx_start = 0;
+        ctx->rx_end = rc;
+      }
+
+        //***Not part of libmodbus - added for QModMaster***//
+        /* First byte of the message, for the response time statistics */
+        if (msg_length == 0)
+            busMonitorRawResponseStart();
+
+        /* Takes the bytes of the current step from the receive buffer */
+        rc = ctx->rx_end - ctx->rx_start;
+        if (rc > length_to_read)
+            rc = length_to_read;
+        memcpy(msg + msg_length, ctx->rx_buffer + ctx->rx_start, rc);
+        ctx->rx_start += rc;
+
         /* Display the hex code of each character received */
         if (ctx->debug) {
             int i;
@@ -637,6 +670,41 @@ static int check_confirmation(modbus_t *ctx, uint8_t *req,
     return rc;
 }
 
+//***Not part of libmodbus - added for QModMaster***//
+/* Number of bytes already read from the link and not parsed yet. A server
+   must serve them before waiting on the socket again. */
+int modbus_get_rx_pending(modbus_t *ctx)
+{
+    if (ctx == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    return ctx->rx_end - ctx->rx_start;
+}
+
+/* Checks a response read with modbus_receive_confirmation against the full
+   request (header included). Returns the number of values or -1 with errno
+   set. Other responses may be pending, the link is never flushed. */
+int modbus_check_confirmation(modbus_t *ctx, uint8_t *req,
+                              uint8_t *rsp, int rsp_length)
+{
+    int rc;
+    int error_recovery;
+
+    if (ctx == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    error_recovery = ctx->error_recovery;
+    ctx->error_recovery = MODBUS_ERROR_RECOVERY_NONE;
+    rc = check_confirmation(ctx, req, rsp, rsp_length);
+    ctx->error_recovery = error_recovery;
+
+    return rc;
+}
+
 static int response_io_status(uint8_t *tab_io_status,
                               int address, int nb,
                               uint8_t *rsp, int offset)
@@ -1570,8 +1638,63 @@ void _modbus_init_common(modbus_t *ctx)
 
     ctx->byte_timeout.tv_sec = 0;
     ctx->byte_timeout.tv_usec = _BYTE_TIMEOUT;
+
+    _modbus_clear_rx_buffer(ctx);
+}
+
+//***Not part of libmodbus - added for QModMaster***//
+/* Drops the bytes read ahead (new link, flush) */
+void _modbus_clear_rx_buffer(modbus_t *ctx)
+{
+    ctx->rx_start = 0;
+    ctx->rx_end = 0;
 }
 
+#ifndef _WIN32
+//***Not part of libmodbus - added for QModMaster***//
+/* Waits for events on the link, poll() has no FD_SETSIZE limit on the
+   descriptor and no fd_set to rebuild after each call.
+   tv NULL waits forever. Returns -1 with errno ETIMEDOUT on timeout. */
+int _modbus_poll(modbus_t *ctx, short events, struct timeval *tv)
+{
+    struct pollfd pfd;
+    int timeout_ms;
+    int rc;
+
+    pfd.fd = ctx->s;
+    pfd.events = events;
+    pfd.revents = 0;
+    if (tv == NULL) {
+        timeout_ms = -1;
+    } else {
+        timeout_ms = tv->tv_sec * 1000 + (tv->tv_usec + 999) / 1000;
+    }
+
+    while ((rc = poll(&pfd, 1, timeout_ms)) == -1) {
+        if (errno == EINTR) {
+            if (ctx->debug) {
+                fprintf(stderr, "A non blocked signal was caught\n");
+            }
+        } else {
+            return -1;
+        }
+    }
+
+    if (rc == 0) {
+        errno = ETIMEDOUT;
+        return -1;
+    }
+
+    if (pfd.revents & POLLNVAL) {
+        errno = EBADF;
+        return -1;
+    }
+
+    /* POLLHUP and POLLERR are reported by the following recv() */
+    return rc;
+}
+#endif
+
 /* Define the slave number */
 int modbus_set_slave(modbus_t *ctx, int slave)
 {
@@ -1604,6 +1727,7 @@ int modbus_set_socket(modbus_t *ctx, int s)
     }
 
     ctx->s = s;
+    _modbus_clear_rx_buffer(ctx);
     return 0;
 }
 
@@ -1686,6 +1810,7 @@ int modbus_connect(modbus_t *ctx)
         return -1;
     }
 
+    _modbus_clear_rx_buffer(ctx);
     return ctx->backend->connect(ctx);
 }
 
@@ -1694,6 +1819,7 @@ void modbus_close(modbus_t *ctx)
     if (ctx == NULL)
         return;
 
+    _modbus_clear_rx_buffer(ctx);
     ctx->backend->close(ctx);
 }
 
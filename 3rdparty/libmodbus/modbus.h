@@ -229,6 +229,13 @@ MODBUS_API int modbus_receive(modbus_t *ctx, uint8_t *req);
 
 MODBUS_API int modbus_receive_confirmation(modbus_t *ctx, uint8_t *rsp);
 
+/* Not part of libmodbus - added for QModMaster (pipelined requests) */
+MODBUS_API int modbus_send_raw_request_tid(modbus_t *ctx, uint8_t *raw_req, int raw_req_length, int tid);
+MODBUS_API int modbus_check_confirmation(modbus_t *ctx, uint8_t *req,
+                                         uint8_t *rsp, int rsp_length);
+/* Not part of libmodbus - added for QModMaster (slave simulator) */
+MODBUS_API int modbus_get_rx_pending(modbus_t *ctx);
+
 MODBUS_API int modbus_reply(modbus_t *ctx, const uint8_t *req,
                             int req_length, modbus_mapping_t *mb_mapping);
 MODBUS_API int modbus_reply_exception(modbus_t *ctx, const uint8_t *req,
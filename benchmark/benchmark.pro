@@ -0,0 +1,49 @@
+#-------------------------------------------------
+#
+# Transactions per second and latency benchmark
+# Runs libmodbus against the built-in slave simulator
+#
+#-------------------------------------------------
+
+QT       += core
+QT       -= gui
+
+TARGET = qModMasterBenchmark
+TEMPLATE = app
+CONFIG   += console
+CONFIG   -= app_bundle
+
+SOURCES += main.cpp \
+    ../src/modbussimulator.cpp \
+    ../3rdparty/libmodbus/modbus.c \
+    ../3rdparty/libmodbus/modbus-data.c \
+    ../3rdparty/libmodbus/modbus-tcp.c \
+    ../3rdparty/libmodbus/modbus-rtu.c \
+    ../3rdparty/QsLog/QsLogDest.cpp \
+    ../3rdparty/QsLog/QsLog.cpp \
+    ../3rdparty/QsLog/QsLogDestConsole.cpp \
+    ../3rdparty/QsLog/QsLogDestFile.cpp
+
+HEADERS  += ../src/modbussimulator.h \
+    ../3rdparty/libmodbus/modbus.h \
+    ../3rdparty/QsLog/QsLog.h \
+    ../3rdparty/QsLog/QsLogDest.h \
+    ../3rdparty/QsLog/QsLogDestConsole.h \
+    ../3rdparty/QsLog/QsLogLevel.h \
+    ../3rdparty/QsLog/QsLogDestFile.h
+
+INCLUDEPATH += .. \
+    ../3rdparty/libmodbus \
+    ../3rdparty/QsLog
+
+unix:DEFINES += _TTY_POSIX_
+
+win32:DEFINES += _TTY_WIN_  WINVER=0x0501
+
+win32:LIBS += -lsetupapi -lwsock32 -lws2_32
+
+# count the malloc calls of libmodbus, operator new is replaced in main.cpp
+linux:QMAKE_LFLAGS += -Wl,--wrap=malloc -Wl,--wrap=calloc -Wl,--wrap=realloc
+linux:DEFINES += BENCHMARK_WRAP_MALLOC
+
+QMAKE_CXXFLAGS += -std=gnu++11
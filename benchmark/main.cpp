@@ -0,0 +1,436 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTextStream>
+#include <QStringList>
+#include <QVector>
+#include <algorithm>
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef Q_OS_UNIX
+#include <sys/resource.h>
+#endif
+
+#include "QsLog.h"
+#include "modbus.h"
+#include "modbus-rtu.h"
+#include "src/modbussimulator.h"
+
+//Transactions run before the measurement - connection setup, caches
+static const int WarmUp = 50;
+
+//Allocations made by the benchmark thread - the simulator thread is not counted
+static thread_local long t_allocs = 0;
+
+#ifdef BENCHMARK_WRAP_MALLOC
+//the wrap also applies to this file : operator new must not be counted twice
+extern "C" void *__real_malloc(size_t size);
+#define BENCHMARK_MALLOC __real_malloc
+#else
+#define BENCHMARK_MALLOC malloc
+#endif
+
+void *operator new(size_t size)
+{
+    t_allocs++;
+    void *p = BENCHMARK_MALLOC(size ? size : 1);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void *p) noexcept
+{
+    free(p);
+}
+
+#ifdef BENCHMARK_WRAP_MALLOC
+//the linker routes the malloc calls of libmodbus here (-Wl,--wrap)
+extern "C" {
+
+void *__real_calloc(size_t n, size_t size);
+void *__real_realloc(void *p, size_t size);
+
+void *__wrap_malloc(size_t size)
+{
+    t_allocs++;
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t n, size_t size)
+{
+    t_allocs++;
+    return __real_calloc(n, size);
+}
+
+void *__wrap_realloc(void *p, size_t size)
+{
+    t_allocs++;
+    return __real_realloc(p, size);
+}
+
+}
+#endif
+
+//libmodbus bus monitor hooks - the benchmark does not capture frames
+extern "C" {
+
+void busMonitorRawResponseData(uint8_t * data, int dataLen)
+{
+    Q_UNUSED(data);
+    Q_UNUSED(dataLen);
+}
+
+void busMonitorRawResponseStart()
+{
+}
+
+void busMonitorRawRequestData(uint8_t * data, int dataLen)
+{
+    Q_UNUSED(data);
+    Q_UNUSED(dataLen);
+}
+
+}
+
+//One measured combination
+struct BenchCase
+{
+    int mode;
+    int functionCode;
+    int noOfItems;
+};
+
+struct BenchResult
+{
+    BenchCase benchCase;
+    int transactions;
+    int errors;
+    double txPerSec;
+    double p50; //us
+    double p99;
+    double p999;
+    double cpu; //us per transaction, -1 : not available
+    double allocs; //per transaction
+};
+
+//CPU time of the calling thread, us
+static qint64 threadCpuTime()
+{
+#if defined(RUSAGE_THREAD)
+    struct rusage usage;
+    getrusage(RUSAGE_THREAD, &usage);
+    return (qint64)usage.ru_utime.tv_sec * 1000000 + usage.ru_utime.tv_usec +
+           (qint64)usage.ru_stime.tv_sec * 1000000 + usage.ru_stime.tv_usec;
+#else
+    return -1;
+#endif
+}
+
+static double percentile(const QVector<qint64> &sorted, double p)
+{
+    if (sorted.isEmpty())
+        return 0;
+    int index = (int)(p * sorted.size());
+    if (index >= sorted.size())
+        index = sorted.size() - 1;
+    return sorted.at(index) / 1000.0;
+}
+
+static int transaction(modbus_t *ctx, const BenchCase &benchCase, uint8_t *bits, uint16_t *regs)
+{
+    switch (benchCase.functionCode) {
+        case MODBUS_FC_READ_COILS:
+            return modbus_read_bits(ctx, 0, benchCase.noOfItems, bits);
+        case MODBUS_FC_READ_HOLDING_REGISTERS:
+            return modbus_read_registers(ctx, 0, benchCase.noOfItems, regs);
+        case MODBUS_FC_WRITE_SINGLE_REGISTER:
+            return modbus_write_register(ctx, 0, regs[0]);
+        case MODBUS_FC_WRITE_MULTIPLE_REGISTERS:
+            return modbus_write_registers(ctx, 0, benchCase.noOfItems, regs);
+        default:
+            return -1;
+    }
+}
+
+//Byte-wise CRC16, the libmodbus algorithm before slice-by-8 - the reference
+static uint16_t crcTable[256];
+
+static void initCrcTable()
+{
+    for (int i = 0; i < 256; i++) {
+        uint16_t crc = i;
+        for (int bit = 0; bit < 8; bit++)
+            crc = (crc & 1) ? (crc >> 1) ^ 0xA001 : crc >> 1;
+        crcTable[i] = crc;
+    }
+}
+
+static uint16_t crc16Reference(const uint8_t *buffer, int length)
+{
+    uint16_t crc = 0xFFFF;
+    while (length--)
+        crc = (crc >> 8) ^ crcTable[(crc ^ *buffer++) & 0xFF];
+    return (uint16_t)((crc << 8) | (crc >> 8));
+}
+
+static int runCrc(QTextStream &out)
+{
+
+    //CRC16 of RTU frames and of large capture buffers, MB/s
+
+    initCrcTable();
+    QByteArray data(1 << 20, 0);
+    for (int i = 0; i < data.size(); i++)
+        data[i] = (char)(rand() & 0xFF);
+    const uint8_t *buffer = (const uint8_t *)data.constData();
+
+    const int sizes[] = {8, 16, 64, 256, 4096, 1 << 20};
+    const int bytesPerCase = 256 << 20;
+    QStringList columns = QString("bytes,reference MB/s,libmodbus MB/s,speedup").split(",");
+    for (int i = 0; i < columns.size(); i++)
+        columns[i] = columns.at(i).rightJustified(15);
+    out << columns.join(" ") << endl;
+
+    for (unsigned int i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        const int size = sizes[i];
+        const int frames = data.size() / size;
+        const int rounds = qMax(1, bytesPerCase / data.size());
+        for (int offset = 0; offset < 8; offset++) {
+            if (crc16Reference(buffer + offset, size - offset) != modbus_rtu_crc16(buffer + offset, size - offset)) {
+                fprintf(stderr, "CRC mismatch, %d bytes\n", size - offset);
+                return 1;
+            }
+        }
+
+        double mbs[2];
+        for (int impl = 0; impl < 2; impl++) {
+            volatile uint16_t sink = 0;
+            QElapsedTimer timer;
+            timer.start();
+            for (int r = 0; r < rounds; r++)
+                for (int f = 0; f < frames; f++)
+                    sink = sink ^ (impl == 0 ? crc16Reference(buffer + f * size, size)
+                                             : modbus_rtu_crc16(buffer + f * size, size));
+            const qint64 elapsed = qMax<qint64>(1, timer.nsecsElapsed());
+            mbs[impl] = (double)rounds * frames * size * 1000.0 / elapsed;
+        }
+
+        out << QString::number(size).rightJustified(15) << " "
+            << QString::number(mbs[0], 'f', 0).rightJustified(15) << " "
+            << QString::number(mbs[1], 'f', 0).rightJustified(15) << " "
+            << QString::number(mbs[1] / mbs[0], 'f', 2).rightJustified(15) << endl;
+    }
+
+    return 0;
+
+}
+
+static QString modeName(int mode)
+{
+    return mode == SimulatorConfig::RTU ? "RTU" : "TCP";
+}
+
+static bool runCase(const BenchCase &benchCase, const QString &address, int port, int baud,
+                    int count, BenchResult &result)
+{
+
+    modbus_t *ctx;
+    if (benchCase.mode == SimulatorConfig::RTU)
+        ctx = modbus_new_rtu(address.toLatin1().constData(), baud, 'N', 8, 1, MODBUS_RTU_RTS_NONE);
+    else
+        ctx = modbus_new_tcp("127.0.0.1", port);
+    if (ctx == NULL)
+        return false;
+    modbus_set_slave(ctx, 1);
+    modbus_set_response_timeout(ctx, 1, 0);
+    if (modbus_connect(ctx) == -1) {
+        modbus_free(ctx);
+        return false;
+    }
+
+    uint8_t bits[MODBUS_MAX_READ_BITS];
+    uint16_t regs[MODBUS_MAX_READ_REGISTERS];
+    memset(bits, 0, sizeof(bits));
+    for (int i = 0; i < MODBUS_MAX_READ_REGISTERS; i++)
+        regs[i] = i;
+
+    for (int i = 0; i < WarmUp; i++)
+        transaction(ctx, benchCase, bits, regs);
+
+    QVector<qint64> latency(count);
+    QElapsedTimer total;
+    QElapsedTimer timer;
+    int errors = 0;
+    const long allocs = t_allocs;
+    const qint64 cpu = threadCpuTime();
+    total.start();
+    for (int i = 0; i < count; i++) {
+        timer.start();
+        if (transaction(ctx, benchCase, bits, regs) == -1)
+            errors++;
+        latency[i] = timer.nsecsElapsed();
+    }
+    const qint64 elapsed = total.nsecsElapsed();
+    const qint64 cpuUsed = threadCpuTime() - cpu;
+    const long allocsUsed = t_allocs - allocs;
+
+    modbus_close(ctx);
+    modbus_free(ctx);
+
+    std::sort(latency.begin(), latency.end());
+    result.benchCase = benchCase;
+    result.transactions = count;
+    result.errors = errors;
+    result.txPerSec = elapsed > 0 ? count * 1e9 / elapsed : 0;
+    result.p50 = percentile(latency, 0.5);
+    result.p99 = percentile(latency, 0.99);
+    result.p999 = percentile(latency, 0.999);
+    result.cpu = cpu < 0 ? -1 : (double)cpuUsed / count;
+    result.allocs = (double)allocsUsed / count;
+    return true;
+
+}
+
+static QString formatResult(const BenchResult &result, const QString &separator)
+{
+    QStringList fields;
+    fields << modeName(result.benchCase.mode)
+           << QString::number(result.benchCase.functionCode)
+           << QString::number(result.benchCase.noOfItems)
+           << QString::number(result.transactions)
+           << QString::number(result.errors)
+           << QString::number(result.txPerSec, 'f', 0)
+           << QString::number(result.p50, 'f', 1)
+           << QString::number(result.p99, 'f', 1)
+           << QString::number(result.p999, 'f', 1)
+           << (result.cpu < 0 ? QString("n/a") : QString::number(result.cpu, 'f', 2))
+           << QString::number(result.allocs, 'f', 2);
+    if (separator == ",")
+        return fields.join(separator);
+    for (int i = 0; i < fields.size(); i++)
+        fields[i] = fields.at(i).rightJustified(i == 0 ? 4 : 9);
+    return fields.join(separator);
+}
+
+int main(int argc, char *argv[])
+{
+
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Measures Modbus transactions per second and latency against the built-in slave simulator");
+    parser.addHelpOption();
+    parser.addOption(QCommandLineOption("transport", "tcp, rtu or all. Default : all.", "name", "all"));
+    parser.addOption(QCommandLineOption("count", "Transactions measured per case. Default : 2000.", "n", "2000"));
+    parser.addOption(QCommandLineOption("port", "TCP port of the simulator. Default : 15020.", "port", "15020"));
+    parser.addOption(QCommandLineOption("baud", "RTU baud rate, sets the inter-frame delays. Default : 115200.", "baud", "115200"));
+    parser.addOption(QCommandLineOption("csv", "Also write the results to a CSV file.", "file"));
+    parser.addOption(QCommandLineOption("crc", "Compare the RTU CRC16 with the byte-wise reference and exit."));
+    parser.process(app);
+
+    if (parser.isSet("crc")) {
+        QTextStream out(stdout);
+        return runCrc(out);
+    }
+
+    //keep the simulator quiet - the results go to stdout
+    QsLogging::Logger::instance().setLoggingLevel(QsLogging::OffLevel);
+
+    const QString transport = parser.value("transport").toLower();
+    const int count = qMax(1, parser.value("count").toInt());
+    const int port = parser.value("port").toInt();
+    const int baud = parser.value("baud").toInt();
+
+    QList<int> modes;
+    if (transport == "tcp" || transport == "all")
+        modes << SimulatorConfig::TCP;
+#ifndef Q_OS_WIN32
+    if (transport == "rtu" || transport == "all")
+        modes << SimulatorConfig::RTU;
+#endif
+    if (modes.isEmpty()) {
+        fprintf(stderr, "Unknown transport %s\n", qPrintable(transport));
+        return 1;
+    }
+
+    //function code, block sizes
+    QList<BenchCase> cases;
+    const int readCoils[] = {1, 100, 2000};
+    const int readRegs[] = {1, 10, 125};
+    const int writeRegs[] = {1, 10, 123};
+    for (int m = 0; m < modes.size(); m++) {
+        for (int i = 0; i < 3; i++) {
+            BenchCase c = {modes.at(m), MODBUS_FC_READ_COILS, readCoils[i]};
+            cases << c;
+        }
+        for (int i = 0; i < 3; i++) {
+            BenchCase c = {modes.at(m), MODBUS_FC_READ_HOLDING_REGISTERS, readRegs[i]};
+            cases << c;
+        }
+        BenchCase single = {modes.at(m), MODBUS_FC_WRITE_SINGLE_REGISTER, 1};
+        cases << single;
+        for (int i = 0; i < 3; i++) {
+            BenchCase c = {modes.at(m), MODBUS_FC_WRITE_MULTIPLE_REGISTERS, writeRegs[i]};
+            cases << c;
+        }
+    }
+
+    QTextStream out(stdout);
+    const QString header = "mode,fc,items,count,errors,tx/s,p50 us,p99 us,p999 us,cpu us/tx,allocs/tx";
+    QStringList columns = header.split(",");
+    for (int i = 0; i < columns.size(); i++)
+        columns[i] = columns.at(i).rightJustified(i == 0 ? 4 : 9);
+    out << columns.join(" ") << endl;
+
+    QFile csv;
+    QTextStream csvOut;
+    if (parser.isSet("csv")) {
+        csv.setFileName(parser.value("csv"));
+        if (!csv.open(QIODevice::WriteOnly | QIODevice::Text)) {
+            fprintf(stderr, "Cannot open %s\n", qPrintable(parser.value("csv")));
+            return 1;
+        }
+        csvOut.setDevice(&csv);
+        csvOut << header << endl;
+    }
+
+    ModbusSimulator simulator;
+    int failed = 0;
+    for (int m = 0; m < modes.size(); m++) {
+        SimulatorConfig config;
+        config.mode = modes.at(m);
+        config.port = port;
+        if (!simulator.startSimulator(config)) {
+            fprintf(stderr, "%s simulator : %s\n", qPrintable(modeName(config.mode)),
+                    qPrintable(simulator.errorString()));
+            failed++;
+            continue;
+        }
+        for (int i = 0; i < cases.size(); i++) {
+            if (cases.at(i).mode != config.mode)
+                continue;
+            BenchResult result;
+            if (!runCase(cases.at(i), simulator.address(), port, baud, count, result)) {
+                fprintf(stderr, "%s connection to %s failed\n", qPrintable(modeName(config.mode)),
+                        qPrintable(simulator.address()));
+                failed++;
+                break;
+            }
+            if (result.errors > 0)
+                failed++;
+            out << formatResult(result, " ") << endl;
+            if (csv.isOpen())
+                csvOut << formatResult(result, ",") << endl;
+        }
+        simulator.stopSimulator();
+    }
+
+    //non zero when a case could not run or had failed transactions
+    return failed > 0 ? 1 : 0;
+
+}
@@ -14,7 +14,9 @@ BusMonitor::BusMonitor(QWidget *parent, RawDataModel *rawDataModel) :
     m_rawDataModel(rawDataModel)
 {
     ui->setupUi(this);
-    ui->lstRawData->setModel(m_rawDataModel->model);
+    ui->lstRawData->setModel(m_rawDataModel);
+    //rows have the same height, the view doesn't measure each line
+    ui->lstRawData->setUniformItemSizes(true);
     //TODO : Delegate
     //ui->lstRawData->setItemDelegate(new RawDataDelegate());
     //Setup Toolbar
@@ -52,7 +54,7 @@ void BusMonitor::save()
 
     //Text Stream
     QTextStream ts(&file);
-    QStringList sl = m_rawDataModel->model->stringList();
+    QStringList sl = m_rawDataModel->lines();
 
     //iterate
     for (int i = 0; i < sl.size(); ++i)
@@ -0,0 +1,255 @@
+#include <QFile>
+#include <QFileDialog>
+#include <QTextStream>
+#include <QHostAddress>
+#include <QShowEvent>
+#include "discovery.h"
+#include "ui_discovery.h"
+
+#include "QsLog.h"
+
+//Result table columns
+enum {ColAddress = 0, ColPort, ColSlave, ColTime, ColModbus, ColInfo, ColumnCount};
+
+Discovery::Discovery(QWidget *parent, ModbusAdapter *adapter, ModbusCommSettings *settings) :
+    QMainWindow(parent),
+    ui(new Ui::Discovery),
+    m_modbusAdapter(adapter),
+    m_modbusCommSettings(settings)
+{
+    //setup UI
+    ui->setupUi(this);
+    ui->toolBar->addAction(ui->actionStart);
+    ui->toolBar->addAction(ui->actionExport);
+    ui->toolBar->addAction(ui->actionClear);
+    ui->toolBar->addAction(ui->actionExit);
+    ui->tblResults->setColumnCount(ColumnCount);
+    ui->tblResults->setHorizontalHeaderLabels(QStringList() << tr("Address") << tr("Port") << tr("Slave")
+                                              << tr("Response (ms)") << tr("Modbus") << tr("Info"));
+    m_discovery = new ModbusDiscovery(this);
+    changedMode(ui->cmbMode->currentIndex());
+
+    //UI - connections
+    connect(ui->actionStart,SIGNAL(toggled(bool)),this,SLOT(startStop(bool)));
+    connect(ui->actionExport,SIGNAL(triggered()),this,SLOT(exportCSV()));
+    connect(ui->actionClear,SIGNAL(triggered()),this,SLOT(clear()));
+    connect(ui->actionExit,SIGNAL(triggered()),this,SLOT(exit()));
+    connect(ui->cmbMode,SIGNAL(currentIndexChanged(int)),this,SLOT(changedMode(int)));
+    connect(m_discovery,SIGNAL(found(DiscoveryResult)),this,SLOT(found(DiscoveryResult)));
+    connect(m_discovery,SIGNAL(progress(int,int)),this,SLOT(progress(int,int)));
+    connect(m_discovery,SIGNAL(finished()),this,SLOT(finished()));
+
+}
+
+Discovery::~Discovery()
+{
+    m_discovery->stop();
+    delete ui;
+}
+
+void Discovery::exit()
+{
+
+   this->close();
+
+}
+
+void Discovery::showEvent(QShowEvent *event)
+{
+
+    //Defaults from the connection settings : its serial port, its subnet
+
+    ui->lblSerial->setText(QString("%1 %2,%3,%4,%5").arg(m_modbusCommSettings->serialPortName(),
+                                                          m_modbusCommSettings->baud(),
+                                                          m_modbusCommSettings->parity().left(1),
+                                                          m_modbusCommSettings->dataBits(),
+                                                          m_modbusCommSettings->stopBits()));
+    if (ui->leFirstIP->text().isEmpty()) {
+        const QHostAddress ip(m_modbusCommSettings->slaveIP());
+        if (ip.protocol() == QAbstractSocket::IPv4Protocol) {
+            const quint32 subnet = ip.toIPv4Address() & 0xffffff00;
+            ui->leFirstIP->setText(QHostAddress(subnet | 1).toString());
+            ui->leLastIP->setText(QHostAddress(subnet | 254).toString());
+        }
+        ui->lePorts->setText(m_modbusCommSettings->TCPPort());
+    }
+    event->accept();
+
+}
+
+QList<int> Discovery::parsePorts(const QString &text)
+{
+
+    //"502, 1502, 5020-5029"
+
+    QList<int> ports;
+    QStringList items = text.split(",", QString::SkipEmptyParts);
+    for (int i = 0; i < items.size(); ++i) {
+        QStringList range = items.at(i).split("-");
+        const int first = range.at(0).trimmed().toInt();
+        const int last = range.size() > 1 ? range.at(1).trimmed().toInt() : first;
+        for (int port = qMax(first, 1); port <= qMin(last, 65535); ++port) {
+            if (!ports.contains(port))
+                ports.append(port);
+        }
+    }
+
+    return ports;
+
+}
+
+void Discovery::startStop(bool value)
+{
+
+    QLOG_TRACE()<<  "Discovery start-stop. Value = " << value;
+
+    if (!value) {
+        m_discovery->stop();
+        return;
+    }
+
+    DiscoveryConfig config;
+    config.mode = ui->cmbMode->currentIndex();
+    config.timeOut = ui->sbTimeOut->value();
+    if (config.mode == DiscoveryConfig::RTU) {
+        if (m_modbusAdapter->isConnected()) {
+            ui->lblStatus->setText(tr("Disconnect first - the sweep opens the serial port."));
+            ui->actionStart->setChecked(false);
+            return;
+        }
+        config.serialPort = m_modbusCommSettings->serialPortName();
+        config.baud = m_modbusCommSettings->baud().toInt();
+        config.parity = EUtils::parity(m_modbusCommSettings->parity());
+        config.dataBits = m_modbusCommSettings->dataBits().toInt();
+        config.stopBits = m_modbusCommSettings->stopBits().toInt();
+        config.RTS = EUtils::RTS(m_modbusCommSettings->RTS());
+        config.firstSlave = ui->sbFirstSlave->value();
+        config.lastSlave = ui->sbLastSlave->value();
+        config.retrySilent = ui->chkRetrySilent->isChecked();
+    }
+    else {
+        config.firstIP = QHostAddress(ui->leFirstIP->text().trimmed()).toIPv4Address();
+        config.lastIP = QHostAddress(ui->leLastIP->text().trimmed()).toIPv4Address();
+        config.ports = parsePorts(ui->lePorts->text());
+        config.unitId = ui->sbUnitId->value();
+        config.connections = ui->sbConnections->value();
+    }
+
+    if (!m_discovery->start(config)) {
+        QLOG_WARN()<<  "Discovery start failed. " << m_discovery->errorString();
+        ui->lblStatus->setText(m_discovery->errorString());
+        ui->actionStart->setChecked(false);
+        return;
+    }
+
+    ui->lblStatus->setText(tr("Scanning..."));
+    enableSettings(false);
+
+}
+
+void Discovery::changedMode(int index)
+{
+
+    const bool rtu = (index == DiscoveryConfig::RTU);
+    ui->sbFirstSlave->setEnabled(rtu);
+    ui->sbLastSlave->setEnabled(rtu);
+    ui->chkRetrySilent->setEnabled(rtu);
+    ui->leFirstIP->setEnabled(!rtu);
+    ui->leLastIP->setEnabled(!rtu);
+    ui->lePorts->setEnabled(!rtu);
+    ui->sbUnitId->setEnabled(!rtu);
+    ui->sbConnections->setEnabled(!rtu);
+
+}
+
+void Discovery::enableSettings(bool enable)
+{
+
+    ui->cmbMode->setEnabled(enable);
+    ui->sbTimeOut->setEnabled(enable);
+    if (enable) {
+        changedMode(ui->cmbMode->currentIndex());
+    }
+    else {
+        ui->sbFirstSlave->setEnabled(false);
+        ui->sbLastSlave->setEnabled(false);
+        ui->chkRetrySilent->setEnabled(false);
+        ui->leFirstIP->setEnabled(false);
+        ui->leLastIP->setEnabled(false);
+        ui->lePorts->setEnabled(false);
+        ui->sbUnitId->setEnabled(false);
+        ui->sbConnections->setEnabled(false);
+    }
+
+}
+
+void Discovery::found(const DiscoveryResult &result)
+{
+
+    QLOG_INFO()<<  "Discovery found " << result.address << ":" << result.port << " slave " << result.slave << " " << result.info;
+
+    const int row = ui->tblResults->rowCount();
+    ui->tblResults->insertRow(row);
+    ui->tblResults->setItem(row, ColAddress, new QTableWidgetItem(result.address));
+    ui->tblResults->setItem(row, ColPort, new QTableWidgetItem(result.port > 0 ? QString::number(result.port) : QString("-")));
+    ui->tblResults->setItem(row, ColSlave, new QTableWidgetItem(QString::number(result.slave)));
+    ui->tblResults->setItem(row, ColTime, new QTableWidgetItem(QString::number(result.responseTime)));
+    ui->tblResults->setItem(row, ColModbus, new QTableWidgetItem(result.modbus ? tr("Yes") : tr("No")));
+    ui->tblResults->setItem(row, ColInfo, new QTableWidgetItem(result.info));
+
+}
+
+void Discovery::progress(int done, int total)
+{
+    ui->progressBar->setMaximum(qMax(total, 1));
+    ui->progressBar->setValue(done);
+}
+
+void Discovery::finished()
+{
+
+    ui->lblStatus->setText(tr("Done. %1 found.").arg(ui->tblResults->rowCount()));
+    enableSettings(true);
+    ui->actionStart->setChecked(false);
+
+}
+
+void Discovery::clear()
+{
+    ui->tblResults->setRowCount(0);
+    ui->progressBar->setValue(0);
+    ui->lblStatus->clear();
+}
+
+void Discovery::exportCSV()
+{
+
+    //Select file
+    QString fileName = QFileDialog::getSaveFileName(NULL,"Export Discovery As...",
+                                                    QDir::homePath(),"CSV (*.csv)");
+
+    //Open File
+    if (fileName.isEmpty())
+        return;
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        QLOG_WARN() <<  "Discovery export failed. File = " << fileName;
+        return;
+    }
+
+    QTextStream ts(&file);
+    ts << "address,port,slave,response_ms,modbus,info" << endl;
+    for (int row = 0; row < ui->tblResults->rowCount(); ++row) {
+        for (int column = 0; column < ColumnCount; ++column) {
+            QString text = ui->tblResults->item(row, column)->text();
+            if (column == ColInfo)
+                text = "\"" + text.replace("\"", "\"\"") + "\"";
+            ts << text << (column == ColumnCount - 1 ? "\n" : ",");
+        }
+    }
+
+    file.close();
+
+    QLOG_INFO() <<  "Discovery exported. File = " << fileName;
+
+}
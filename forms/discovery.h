@@ -0,0 +1,46 @@
+#ifndef DISCOVERY_H
+#define DISCOVERY_H
+
+#include <QMainWindow>
+#include <QList>
+
+#include "src/modbusadapter.h"
+#include "src/modbuscommsettings.h"
+#include "src/modbusdiscovery.h"
+
+namespace Ui {
+class Discovery;
+}
+
+class Discovery : public QMainWindow
+{
+    Q_OBJECT
+
+public:
+    explicit Discovery(QWidget *parent = 0, ModbusAdapter *adapter = 0, ModbusCommSettings *settings = 0);
+    ~Discovery();
+
+private:
+    Ui::Discovery *ui;
+    ModbusAdapter *m_modbusAdapter;
+    ModbusCommSettings *m_modbusCommSettings;
+    ModbusDiscovery *m_discovery;
+    QList<int> parsePorts(const QString &text);
+    void enableSettings(bool enable);
+
+protected:
+    void showEvent(QShowEvent *event);
+
+private slots:
+    void exit();
+    void startStop(bool value);
+    void changedMode(int index);
+    void clear();
+    void exportCSV();
+    void found(const DiscoveryResult &result);
+    void progress(int done, int total);
+    void finished();
+
+};
+
+#endif // DISCOVERY_H
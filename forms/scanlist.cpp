@@ -0,0 +1,283 @@
+#include <QFileDialog>
+#include "scanlist.h"
+#include "ui_scanlist.h"
+
+#include "QsLog.h"
+#include "src/eutils.h"
+
+//Table columns
+enum {ColDevice = 0, ColSlave, ColFunction, ColStartAddr, ColNoOfItems, ColPeriod, ColStatus, ColValues};
+//Number format of each base index (Bin, Dec, Hex)
+static const int Bases[] = {EUtils::Bin, EUtils::UInt, EUtils::Hex};
+
+ScanList::ScanList(QWidget *parent, ModbusAdapter *adapter, ModbusCommSettings *settings) :
+    QMainWindow(parent),
+    ui(new Ui::ScanList),
+    m_modbusAdapter(adapter), m_modbusCommSettings(settings)
+{
+    //setup UI
+    ui->setupUi(this);
+    m_updating = false;
+    ui->toolBar->addAction(ui->actionAdd);
+    ui->toolBar->addAction(ui->actionRemove);
+    ui->toolBar->addAction(ui->actionExportHistory);
+    ui->toolBar->addSeparator();
+    ui->toolBar->addAction(ui->actionStart);
+    ui->toolBar->addAction(ui->actionExit);
+
+    //UI - connections
+    connect(ui->actionAdd,SIGNAL(triggered()),this,SLOT(addEntry()));
+    connect(ui->actionRemove,SIGNAL(triggered()),this,SLOT(removeEntry()));
+    connect(ui->actionExportHistory,SIGNAL(triggered()),this,SLOT(exportHistory()));
+    connect(ui->actionStart,SIGNAL(toggled(bool)),this,SLOT(startStop(bool)));
+    connect(ui->actionExit,SIGNAL(triggered()),this,SLOT(exit()));
+    connect(ui->tblScanList,SIGNAL(itemChanged(QTableWidgetItem*)),this,SLOT(itemChanged(QTableWidgetItem*)));
+    connect(m_modbusAdapter->scheduler,SIGNAL(entryUpdated(int,ModbusResult)),this,SLOT(entryUpdated(int,ModbusResult)));
+    connect(m_modbusAdapter->scheduler,SIGNAL(runningChanged(bool)),this,SLOT(runningChanged(bool)));
+
+    reload();
+
+}
+
+ScanList::~ScanList()
+{
+    delete ui;
+}
+
+void ScanList::exit()
+{
+
+   this->close();
+
+}
+
+void ScanList::reload()
+{
+
+    //Load scan list from settings
+
+    m_modbusAdapter->scheduler->stop();
+    m_modbusAdapter->scheduler->setEntries(m_modbusCommSettings->scanList());
+
+    QList<ScanEntry> entries = m_modbusAdapter->scheduler->entries();
+    m_updating = true;
+    ui->tblScanList->setRowCount(entries.size());
+    for (int i = 0; i < entries.size(); ++i)
+        setRow(i, entries.at(i));
+    m_updating = false;
+
+}
+
+void ScanList::setRow(int row, const ScanEntry &entry)
+{
+
+    QStringList text;
+
+    text << (entry.ip.isEmpty() ? QString("") : entry.ip + ":" + QString::number(entry.port))
+         << QString::number(entry.slave)
+         << QString().sprintf("0x%.2x", entry.functionCode)
+         << QString::number(entry.startAddr)
+         << QString::number(entry.noOfItems)
+         << QString::number(entry.period)
+         << "-" << "";
+
+    for (int col = 0; col < text.size(); ++col) {
+        QTableWidgetItem *item = ui->tblScanList->item(row, col);
+        if (item == NULL) {
+            item = new QTableWidgetItem();
+            if (col == ColFunction || col >= ColStatus)
+                item->setFlags(item->flags() & ~Qt::ItemIsEditable);
+            ui->tblScanList->setItem(row, col, item);
+        }
+        item->setText(text.at(col));
+    }
+
+}
+
+void ScanList::saveEntries()
+{
+
+    m_modbusCommSettings->setScanList(m_modbusAdapter->scheduler->entries());
+    m_modbusCommSettings->saveSettings();
+
+}
+
+void ScanList::addEntry()
+{
+
+    //New entry from the main window request settings - read functions only
+
+    ScanEntry entry;
+    int functionCode = EUtils::ModbusFunctionCode(m_modbusCommSettings->functionCode());
+
+    if (!EUtils::ModbusIsWriteFunction(functionCode))
+        entry.functionCode = functionCode;
+    entry.slave = m_modbusCommSettings->slaveID();
+    entry.startAddr = m_modbusCommSettings->startAddr() + m_modbusCommSettings->baseAddr().toInt();
+    entry.noOfItems = m_modbusCommSettings->noOfRegs();
+    entry.period = m_modbusCommSettings->scanRate();
+
+    QLOG_TRACE()<<  "Scan list add entry. Function Code = " << entry.functionCode;
+
+    m_modbusAdapter->scheduler->addEntry(entry);
+    m_updating = true;
+    ui->tblScanList->insertRow(ui->tblScanList->rowCount());
+    setRow(ui->tblScanList->rowCount() - 1, entry);
+    m_updating = false;
+    saveEntries();
+
+}
+
+void ScanList::removeEntry()
+{
+
+    int row = ui->tblScanList->currentRow();
+
+    QLOG_TRACE()<<  "Scan list remove entry. Row = " << row;
+
+    if (row < 0)
+        return;
+
+    m_modbusAdapter->scheduler->removeEntry(row);
+    ui->tblScanList->removeRow(row);
+    saveEntries();
+
+}
+
+void ScanList::exportHistory()
+{
+
+    //Recorded polls of the selected entry to CSV
+
+    int row = ui->tblScanList->currentRow();
+    QList<ScanEntry> entries = m_modbusAdapter->scheduler->entries();
+    if (row < 0 || row >= entries.size())
+        return;
+
+    QString fileName = QFileDialog::getSaveFileName(NULL,"Export History As...",
+                                                    QDir::homePath(),"CSV (*.csv)");
+    if (fileName.isEmpty())
+        return;
+
+    if (!m_modbusAdapter->historian->exportCSV(entries.at(row), fileName))
+        QLOG_WARN()<<  "Scan list history export failed. Row = " << row;
+
+}
+
+void ScanList::startStop(bool value)
+{
+
+    //Start-Stop scan list
+
+    if (value == m_modbusAdapter->scheduler->isRunning())
+        return;
+
+    if (value) {
+        //entries without a device use the current connection
+        bool needsConnection = false;
+        QList<ScanEntry> entries = m_modbusAdapter->scheduler->entries();
+        for (int i = 0; i < entries.size(); ++i)
+            needsConnection |= entries.at(i).ip.isEmpty();
+        if (needsConnection && !m_modbusAdapter->isConnected()) {
+            QLOG_WARN()<<  "Scan list not started. Not connected";
+            ui->actionStart->setChecked(false);
+            return;
+        }
+        m_modbusAdapter->scheduler->start();
+        if (!m_modbusAdapter->scheduler->isRunning())
+            ui->actionStart->setChecked(false);
+    }
+    else
+        m_modbusAdapter->scheduler->stop();
+
+}
+
+void ScanList::runningChanged(bool running)
+{
+
+    //Entries can be edited only when the scan list is stopped
+
+    ui->actionStart->setChecked(running);
+    ui->actionAdd->setEnabled(!running);
+    ui->actionRemove->setEnabled(!running);
+    ui->tblScanList->setEditTriggers(running ? QAbstractItemView::NoEditTriggers :
+                                               QAbstractItemView::DoubleClicked | QAbstractItemView::EditKeyPressed);
+
+}
+
+void ScanList::itemChanged(QTableWidgetItem *item)
+{
+
+    if (m_updating)
+        return;
+
+    int row = item->row();
+    QList<ScanEntry> entries = m_modbusAdapter->scheduler->entries();
+    if (row < 0 || row >= entries.size())
+        return;
+
+    ScanEntry entry = entries.at(row);
+    bool ok;
+    int value = item->text().toInt(&ok);
+    if (item->column() == ColDevice) {
+        //ip[:port], empty for the current connection
+        QString text = item->text().trimmed();
+        entry.ip = text.section(':', 0, 0);
+        entry.port = text.section(':', 1, 1).toInt(&ok);
+        if (!ok || entry.port <= 0 || entry.port > 65535)
+            entry.port = 502;
+    }
+    else if (ok) {
+        switch (item->column())
+        {
+            case ColSlave:
+                entry.slave = qBound(0, value, 247);
+                break;
+            case ColStartAddr:
+                entry.startAddr = qBound(0, value, 65535);
+                break;
+            case ColNoOfItems:
+                entry.noOfItems = qBound(1, value, MaxAddressSpace - entry.startAddr);
+                break;
+            case ColPeriod:
+                entry.period = qBound(10, value, 3600000);
+                break;
+            default:
+                break;
+        }
+    }
+
+    QLOG_TRACE()<<  "Scan list entry changed. Row = " << row;
+
+    m_modbusAdapter->scheduler->setEntry(row, entry);
+    m_updating = true;
+    setRow(row, entry);
+    m_updating = false;
+    saveEntries();
+
+}
+
+void ScanList::entryUpdated(int index, const ModbusResult &result)
+{
+
+    //Show the last values read
+
+    if (index >= ui->tblScanList->rowCount())
+        return;
+
+    QString values;
+    bool is16Bit = !(result.request.functionCode == MODBUS_FC_READ_COILS ||
+                     result.request.functionCode == MODBUS_FC_READ_DISCRETE_INPUTS);
+
+    m_updating = true;
+    if (result.ret == result.request.noOfItems) {
+        for (int i = 0; i < result.data.size(); ++i)
+            values += EUtils::formatValue(result.data[i], Bases[qBound(0, m_modbusCommSettings->base(), 2)], is16Bit, false) + " ";
+        ui->tblScanList->item(index, ColStatus)->setText(tr("OK"));
+    }
+    else
+        ui->tblScanList->item(index, ColStatus)->setText(EUtils::libmodbus_strerror(result.error));
+    ui->tblScanList->item(index, ColValues)->setText(values.trimmed());
+    m_updating = false;
+
+}
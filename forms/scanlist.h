@@ -0,0 +1,43 @@
+#ifndef SCANLIST_H
+#define SCANLIST_H
+
+#include <QMainWindow>
+#include <QTableWidgetItem>
+
+#include "src/modbusadapter.h"
+#include "src/modbuscommsettings.h"
+
+namespace Ui {
+class ScanList;
+}
+
+class ScanList : public QMainWindow
+{
+    Q_OBJECT
+
+public:
+    explicit ScanList(QWidget *parent = 0, ModbusAdapter *adapter = 0, ModbusCommSettings *settings = 0);
+    ~ScanList();
+    void reload();
+
+private:
+    Ui::ScanList *ui;
+    ModbusAdapter *m_modbusAdapter;
+    ModbusCommSettings *m_modbusCommSettings;
+    bool m_updating;
+    void setRow(int row, const ScanEntry &entry);
+    void saveEntries();
+
+private slots:
+    void exit();
+    void addEntry();
+    void removeEntry();
+    void exportHistory();
+    void startStop(bool value);
+    void runningChanged(bool running);
+    void itemChanged(QTableWidgetItem *item);
+    void entryUpdated(int index, const ModbusResult &result);
+
+};
+
+#endif // SCANLIST_H
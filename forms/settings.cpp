@@ -26,6 +26,11 @@ void Settings::showEvent(QShowEvent * event)
         ui->sbMaxNoOfRawDataLines->setValue(m_settings->maxNoOfLines().toInt());
         ui->sbResponseTimeout->setValue(m_settings->timeOut().toInt());
         ui->sbBaseAddr->setValue(m_settings->baseAddr().toInt());
+        ui->sbMaxGap->setValue(m_settings->maxGap().toInt());
+        ui->chkHighlightChanges->setChecked(m_settings->highlightChanges());
+        ui->chkHistory->setChecked(m_settings->history());
+        ui->chkVerifyWrites->setChecked(m_settings->verifyWrites());
+        ui->chkAdaptiveTimeOut->setChecked(m_settings->adaptiveTimeOut());
     }
 
 }
@@ -38,6 +43,11 @@ void Settings::changesAccepted()
         m_settings->setMaxNoOfLines(ui->sbMaxNoOfRawDataLines->cleanText());
         m_settings->setTimeOut(ui->sbResponseTimeout->cleanText());
         m_settings->setBaseAddr(ui->sbBaseAddr->cleanText());
+        m_settings->setMaxGap(ui->sbMaxGap->cleanText());
+        m_settings->setHighlightChanges(ui->chkHighlightChanges->isChecked());
+        m_settings->setHistory(ui->chkHistory->isChecked());
+        m_settings->setVerifyWrites(ui->chkVerifyWrites->isChecked());
+        m_settings->setAdaptiveTimeOut(ui->chkAdaptiveTimeOut->isChecked());
     }
 
 }
@@ -1,6 +1,7 @@
 #include <QtDebug>
 #include "settingsmodbusrtu.h"
 #include "ui_settingsmodbusrtu.h"
+#include "src/eutils.h"
 
 SettingsModbusRTU::SettingsModbusRTU(QWidget *parent,ModbusCommSettings * settings) :
     QDialog(parent),
@@ -34,16 +35,7 @@ void SettingsModbusRTU::showEvent(QShowEvent * event)
          ui->cmbRTS->clear();
 
         //Populate cmbPort-cmbRTS
-        #ifdef Q_OS_WIN32
-            ui->cmbRTS->addItem("Disable");
-            ui->cmbRTS->addItem("Enable");
-            ui->cmbRTS->addItem("HandShake");
-            ui->cmbRTS->addItem("Toggle");
-        #else
-            ui->cmbRTS->addItem("None");
-            ui->cmbRTS->addItem("Up");
-            ui->cmbRTS->addItem("Down");
-        #endif
+        ui->cmbRTS->addItems(ModbusRTSModes);
 
         ui->cmbDev->setCurrentText(m_settings->serialDev());
         ui->sbPort->setValue(m_settings->serialPort().toInt());
@@ -25,6 +25,7 @@ void SettingsModbusTCP::showEvent(QShowEvent * event)
     if (m_settings != NULL) {
         ui->leTCPPort->setText(m_settings->TCPPort());
         ui->leSlaveIP->setText(m_settings->slaveIP());
+        ui->sbPipelineDepth->setValue(m_settings->pipelineDepth().toInt());
     }
 
 }
@@ -40,6 +41,7 @@ void SettingsModbusTCP::changesAccepted()
             if (m_settings != NULL) {
                 m_settings->setTCPPort(ui->leTCPPort->text());
                 m_settings->setSlaveIP(ui->leSlaveIP->text());
+                m_settings->setPipelineDepth(ui->sbPipelineDepth->cleanText());
             }
             break;
         case 1 : // wrong ip
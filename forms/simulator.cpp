@@ -0,0 +1,109 @@
+#include "simulator.h"
+#include "ui_simulator.h"
+
+#include "QsLog.h"
+
+Simulator::Simulator(QWidget *parent) :
+    QMainWindow(parent),
+    ui(new Ui::Simulator)
+{
+    //setup UI
+    ui->setupUi(this);
+    ui->toolBar->addAction(ui->actionStart);
+    ui->toolBar->addAction(ui->actionExit);
+    m_simulator = new ModbusSimulator(this);
+    m_countersTimer = new QTimer(this);
+
+    //UI - connections
+    connect(ui->actionStart,SIGNAL(toggled(bool)),this,SLOT(startStop(bool)));
+    connect(ui->actionExit,SIGNAL(triggered()),this,SLOT(exit()));
+    connect(ui->cmbMode,SIGNAL(currentIndexChanged(int)),this,SLOT(changedMode(int)));
+    connect(m_countersTimer,SIGNAL(timeout()),this,SLOT(updateCounters()));
+
+}
+
+Simulator::~Simulator()
+{
+    m_simulator->stopSimulator();
+    delete ui;
+}
+
+void Simulator::exit()
+{
+
+   this->close();
+
+}
+
+void Simulator::startStop(bool value)
+{
+
+    //Start-Stop the simulated slave - it keeps running when the window is closed
+
+    QLOG_TRACE()<<  "Simulator start-stop. Value = " << value;
+
+    if (!value) {
+        m_simulator->stopSimulator();
+        m_countersTimer->stop();
+        ui->lblAddress->setText(tr("Stopped"));
+        enableSettings(true);
+        return;
+    }
+
+    SimulatorConfig config;
+    config.mode = ui->cmbMode->currentIndex();
+    config.port = ui->sbPort->value();
+    config.slave = ui->sbSlave->value();
+    config.startAddr = ui->sbStartAddr->value();
+    config.noOfItems = ui->sbNoOfItems->value();
+    config.delay = ui->sbDelay->value();
+    config.jitter = ui->sbJitter->value();
+    config.dropRate = ui->sbDropRate->value();
+    config.exceptionRate = ui->sbExceptionRate->value();
+
+    if (!m_simulator->startSimulator(config)) {
+        QLOG_ERROR()<<  "Simulator start failed. " << m_simulator->errorString();
+        ui->lblAddress->setText(m_simulator->errorString());
+        ui->actionStart->setChecked(false);
+        return;
+    }
+
+    if (config.mode == SimulatorConfig::RTU)
+        ui->lblAddress->setText(tr("Serial device : %1").arg(m_simulator->address()));
+    else
+        ui->lblAddress->setText(tr("Listening on %1").arg(m_simulator->address()));
+    enableSettings(false);
+    updateCounters();
+    m_countersTimer->start(500);
+
+}
+
+void Simulator::changedMode(int index)
+{
+    ui->sbPort->setEnabled(index == SimulatorConfig::TCP);
+}
+
+void Simulator::enableSettings(bool enable)
+{
+
+    ui->cmbMode->setEnabled(enable);
+    ui->sbPort->setEnabled(enable && ui->cmbMode->currentIndex() == SimulatorConfig::TCP);
+    ui->sbSlave->setEnabled(enable);
+    ui->sbStartAddr->setEnabled(enable);
+    ui->sbNoOfItems->setEnabled(enable);
+    ui->sbDelay->setEnabled(enable);
+    ui->sbJitter->setEnabled(enable);
+    ui->sbDropRate->setEnabled(enable);
+    ui->sbExceptionRate->setEnabled(enable);
+
+}
+
+void Simulator::updateCounters()
+{
+
+    ui->lblCounters->setText(tr("Requests : %1  Replies : %2  Injected errors : %3")
+                             .arg(m_simulator->requests())
+                             .arg(m_simulator->replies())
+                             .arg(m_simulator->errors()));
+
+}
@@ -0,0 +1,35 @@
+#ifndef SIMULATOR_H
+#define SIMULATOR_H
+
+#include <QMainWindow>
+#include <QTimer>
+
+#include "src/modbussimulator.h"
+
+namespace Ui {
+class Simulator;
+}
+
+class Simulator : public QMainWindow
+{
+    Q_OBJECT
+
+public:
+    explicit Simulator(QWidget *parent = 0);
+    ~Simulator();
+
+private:
+    Ui::Simulator *ui;
+    ModbusSimulator *m_simulator;
+    QTimer *m_countersTimer;
+    void enableSettings(bool enable);
+
+private slots:
+    void exit();
+    void startStop(bool value);
+    void changedMode(int index);
+    void updateCounters();
+
+};
+
+#endif // SIMULATOR_H
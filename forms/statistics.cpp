@@ -0,0 +1,190 @@
+#include <algorithm>
+#include <QFile>
+#include <QFileDialog>
+#include <QTextStream>
+#include <QCloseEvent>
+#include <QShowEvent>
+#include "statistics.h"
+#include "ui_statistics.h"
+
+#include "QsLog.h"
+
+//Table columns
+enum {ColDevice = 0, ColSlave, ColFunction, ColTransactions, ColErrors,
+      ColQueueP50, ColQueueP99, ColResponseP50, ColResponseP99, ColResponseMax,
+      ColTransferP50, ColTransferP99, ColTotalP50, ColTotalP99, ColTotalP999, ColumnCount};
+
+static bool lessThan(const ModbusTimingEntry *a, const ModbusTimingEntry *b)
+{
+    if (a->device != b->device)
+        return a->device < b->device;
+    if (a->slave != b->slave)
+        return a->slave < b->slave;
+    return a->functionCode < b->functionCode;
+}
+
+static QString ms(qint64 us)
+{
+    return QString::number(us / 1000.0, 'f', 2);
+}
+
+Statistics::Statistics(QWidget *parent, ModbusAdapter *adapter) :
+    QMainWindow(parent),
+    ui(new Ui::Statistics),
+    m_modbusAdapter(adapter)
+{
+    //setup UI
+    ui->setupUi(this);
+    ui->toolBar->addAction(ui->actionExport);
+    ui->toolBar->addAction(ui->actionReset);
+    ui->toolBar->addAction(ui->actionExit);
+    ui->tblStatistics->setColumnCount(ColumnCount);
+    ui->tblStatistics->setHorizontalHeaderLabels(QStringList() << tr("Device") << tr("Slave") << tr("Function")
+                                                 << tr("Count") << tr("Errors")
+                                                 << tr("Queue p50") << tr("Queue p99")
+                                                 << tr("Response p50") << tr("Response p99") << tr("Response max")
+                                                 << tr("Transfer p50") << tr("Transfer p99")
+                                                 << tr("Total p50") << tr("Total p99") << tr("Total p99.9"));
+    m_refreshTimer = new QTimer(this);
+
+    //UI - connections
+    connect(ui->actionExport,SIGNAL(triggered()),this,SLOT(exportCSV()));
+    connect(ui->actionReset,SIGNAL(triggered()),this,SLOT(reset()));
+    connect(ui->actionExit,SIGNAL(triggered()),this,SLOT(exit()));
+    connect(m_refreshTimer,SIGNAL(timeout()),this,SLOT(refresh()));
+
+}
+
+Statistics::~Statistics()
+{
+    delete ui;
+}
+
+QList<const ModbusTimingEntry *> Statistics::sortedEntries()
+{
+    QList<const ModbusTimingEntry *> entries = m_modbusAdapter->statistics->entries();
+    std::sort(entries.begin(), entries.end(), lessThan);
+    return entries;
+}
+
+void Statistics::setCell(int row, int column, const QString &text)
+{
+    QTableWidgetItem *item = ui->tblStatistics->item(row, column);
+    if (item == NULL) {
+        item = new QTableWidgetItem();
+        if (column != ColDevice)
+            item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+        ui->tblStatistics->setItem(row, column, item);
+    }
+    if (item->text() != text)
+        item->setText(text);
+}
+
+void Statistics::refresh()
+{
+
+    //Histograms are read while the workers record - a snapshot is good enough
+
+    QList<const ModbusTimingEntry *> entries = sortedEntries();
+    ui->tblStatistics->setRowCount(entries.size());
+
+    for (int i = 0; i < entries.size(); ++i) {
+        const ModbusTimingEntry *e = entries.at(i);
+        setCell(i, ColDevice, m_modbusAdapter->deviceName(e->device));
+        setCell(i, ColSlave, QString::number(e->slave));
+        setCell(i, ColFunction, "0x" + QString::number(e->functionCode, 16).rightJustified(2, '0'));
+        setCell(i, ColTransactions, QString::number(e->total.count()));
+        setCell(i, ColErrors, QString::number(e->errors.loadAcquire()));
+        setCell(i, ColQueueP50, ms(e->queue.percentile(50)));
+        setCell(i, ColQueueP99, ms(e->queue.percentile(99)));
+        setCell(i, ColResponseP50, ms(e->response.percentile(50)));
+        setCell(i, ColResponseP99, ms(e->response.percentile(99)));
+        setCell(i, ColResponseMax, ms(e->response.max()));
+        setCell(i, ColTransferP50, ms(e->transfer.percentile(50)));
+        setCell(i, ColTransferP99, ms(e->transfer.percentile(99)));
+        setCell(i, ColTotalP50, ms(e->total.percentile(50)));
+        setCell(i, ColTotalP99, ms(e->total.percentile(99)));
+        setCell(i, ColTotalP999, ms(e->total.percentile(99.9)));
+    }
+
+}
+
+void Statistics::exportCSV()
+{
+
+    //Select file
+    QString fileName = QFileDialog::getSaveFileName(NULL,"Export Statistics As...",
+                                                    QDir::homePath(),"CSV (*.csv)");
+
+    //Open File
+    if (fileName.isEmpty())
+        return;
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        QLOG_WARN() <<  "Statistics export failed. File = " << fileName;
+        return;
+    }
+
+    //one line per phase, times in us
+    QTextStream ts(&file);
+    ts << "device,slave,function,phase,count,errors,min,mean,p50,p90,p99,p999,max" << endl;
+
+    QList<const ModbusTimingEntry *> entries = sortedEntries();
+    for (int i = 0; i < entries.size(); ++i) {
+        const ModbusTimingEntry *e = entries.at(i);
+        const LatencyHistogram *phases[] = {&e->queue, &e->response, &e->transfer, &e->total};
+        const char *names[] = {"queue", "response", "transfer", "total"};
+        for (int j = 0; j < 4; ++j) {
+            const LatencyHistogram *h = phases[j];
+            ts << m_modbusAdapter->deviceName(e->device) << ","
+               << e->slave << ","
+               << e->functionCode << ","
+               << names[j] << ","
+               << h->count() << ","
+               << e->errors.loadAcquire() << ","
+               << h->min() << ","
+               << h->mean() << ","
+               << h->percentile(50) << ","
+               << h->percentile(90) << ","
+               << h->percentile(99) << ","
+               << h->percentile(99.9) << ","
+               << h->max() << endl;
+        }
+    }
+
+    file.close();
+
+    QLOG_INFO() <<  "Statistics exported. File = " << fileName;
+
+}
+
+void Statistics::reset()
+{
+    m_modbusAdapter->statistics->reset();
+    refresh();
+}
+
+void Statistics::exit()
+{
+
+   this->close();
+
+}
+
+void Statistics::showEvent(QShowEvent *event)
+{
+
+    //refresh only while visible
+    refresh();
+    m_refreshTimer->start(1000);
+    event->accept();
+
+}
+
+void Statistics::closeEvent(QCloseEvent *event)
+{
+
+    m_refreshTimer->stop();
+    event->accept();
+
+}
@@ -0,0 +1,40 @@
+#ifndef STATISTICS_H
+#define STATISTICS_H
+
+#include <QMainWindow>
+#include <QTimer>
+
+#include "src/modbusadapter.h"
+
+namespace Ui {
+class Statistics;
+}
+
+class Statistics : public QMainWindow
+{
+    Q_OBJECT
+
+public:
+    explicit Statistics(QWidget *parent = 0, ModbusAdapter *adapter = 0);
+    ~Statistics();
+
+private:
+    Ui::Statistics *ui;
+    ModbusAdapter *m_modbusAdapter;
+    QTimer *m_refreshTimer;
+    QList<const ModbusTimingEntry *> sortedEntries();
+    void setCell(int row, int column, const QString &text);
+
+private slots:
+    void refresh();
+    void exportCSV();
+    void reset();
+    void exit();
+
+protected:
+    void showEvent(QShowEvent *event);
+    void closeEvent(QCloseEvent *event);
+
+};
+
+#endif // STATISTICS_H
@@ -3,6 +3,10 @@
 
 #include "QsLog.h"
 
+//Modbus ping rounds
+static const int PingCount = 4;
+static const int PingInterval = 500; //ms
+
 Tools::Tools(QWidget *parent, ModbusAdapter *adapter, ModbusCommSettings *settings) :
     QMainWindow(parent),
     m_modbusAdapter(adapter), m_modbusCommSettings(settings),
@@ -10,6 +14,7 @@ Tools::Tools(QWidget *parent, ModbusAdapter *adapter, ModbusCommSettings *settin
 {
     //setup UI
     ui->setupUi(this);
+    m_portCheck = false;
     cmbModbusMode = new QComboBox(this);
     cmbModbusMode->setMinimumWidth(96);
     cmbModbusMode->addItem("RTU/TCP");cmbModbusMode->addItem("TCP");
@@ -28,8 +33,9 @@ Tools::Tools(QWidget *parent, ModbusAdapter *adapter, ModbusCommSettings *settin
     connect(ui->actionExec,SIGNAL(triggered(bool)),this,SLOT(execCmd()));
     connect(ui->actionClear,SIGNAL(triggered(bool)),this,SLOT(clear()));
     connect(ui->actionExit,SIGNAL(triggered()),this,SLOT(exit()));
-    connect(&m_pingProc,SIGNAL(readyReadStandardOutput()),this,SLOT(pingData()));
-    connect(&m_pingProc,SIGNAL(readyReadStandardError()),this,SLOT(pingData()));
+    connect(&m_ping,SIGNAL(roundDone(PingRound)),this,SLOT(pingRound(PingRound)));
+    connect(&m_ping,SIGNAL(finished()),this,SLOT(pingFinished()));
+    connect(m_modbusAdapter,SIGNAL(transactionDone(ModbusResult)),this,SLOT(diagnosticsData(ModbusResult)));
 
 }
 
@@ -87,6 +93,7 @@ void Tools::execCmd()
     ui->txtOutput->moveCursor(QTextCursor::End);
 
     QLOG_TRACE()<<  "Tools Execute Cmd " << cmbCmd->currentText();
+    m_ping.stop();
     switch (cmbCmd->currentIndex()){
         case 0:
         ui->txtOutput->appendPlainText(QString("------- Modbus Diagnotics : Report Slave ID %1 -------\n").arg(m_modbusCommSettings->slaveID()));
@@ -94,7 +101,7 @@ void Tools::execCmd()
         break;
 
         case 1:
-        ui->txtOutput->appendPlainText(QString("------- Modbus TCP : Ping IP %1 -------\n").arg(m_modbusCommSettings->slaveIP()));
+        ui->txtOutput->appendPlainText(QString("------- Modbus TCP : Ping %1:%2 , Slave ID %3 -------\n").arg(m_modbusCommSettings->slaveIP(),m_modbusCommSettings->TCPPort()).arg(m_modbusCommSettings->slaveID()));
         pingProc();
         break;
 
@@ -124,7 +131,7 @@ void Tools::diagnosticsProc()
 
     qApp->processEvents();
     ui->txtOutput->moveCursor(QTextCursor::End);
-    if(m_modbusAdapter->m_modbus != NULL){
+    if(m_modbusAdapter->isConnected()){
         modbusDiagnostics();
     }
     else{
@@ -136,35 +143,50 @@ void Tools::diagnosticsProc()
 void Tools::pingProc()
 {
 
-    qApp->processEvents();
-    m_pingProc.start("ping", QStringList() << ipConv(m_modbusCommSettings->slaveIP()));
-    if (m_pingProc.waitForFinished(5000)){
-            //just wait -> execute button is pressed
+    //TCP connect and read of holding register 0, repeated - no ICMP, no process
+    m_portCheck = false;
+    m_ping.start(ipConv(m_modbusCommSettings->slaveIP()), m_modbusCommSettings->TCPPort().toInt(),
+                 m_modbusCommSettings->slaveID(), PingCount, PingInterval,
+                 m_modbusCommSettings->timeOut().toInt() * 1000);
+
+}
+
+void Tools::pingRound(const PingRound &round)
+{
+
+    ui->txtOutput->moveCursor(QTextCursor::End);
+    if (m_portCheck) {
+        ui->txtOutput->insertPlainText(round.connectTime < 0 ? "Not connected.Port is closed\n" : "Connected.Port is opened\n");
+        return;
     }
+
+    QString line = QString("seq=%1").arg(round.seq);
+    if (round.connectTime >= 0)
+        line += QString(" connect=%1 ms").arg(round.connectTime, 0, 'f', 2);
+    if (round.modbusTime >= 0)
+        line += QString(" modbus=%1 ms").arg(round.modbusTime, 0, 'f', 2);
+    ui->txtOutput->insertPlainText(line + " : " + round.info + "\n");
+
 }
 
-void Tools::pingData()
+void Tools::pingFinished()
 {
 
-    qApp->processEvents();
+    if (m_portCheck)
+        return;
     ui->txtOutput->moveCursor(QTextCursor::End);
-    ui->txtOutput->insertPlainText(m_pingProc.readAll());
+    ui->txtOutput->insertPlainText(m_ping.summary() + "\n");
 
 }
 
 void Tools::portProc()
 {
 
-    qApp->processEvents();
-    ui->txtOutput->moveCursor(QTextCursor::End);
-    m_portProc.connectToHost(ipConv(m_modbusCommSettings->slaveIP()),m_modbusCommSettings->TCPPort().toInt());
-    if (m_portProc.waitForConnected(5000)){//wait -> execute button is pressed
-        ui->txtOutput->insertPlainText("Connected.Port is opened\n");
-        m_portProc.close();
-    }
-    else{
-         ui->txtOutput->insertPlainText("Not connected.Port is closed\n");
-    }
+    //one connect, no request
+    m_portCheck = true;
+    m_ping.start(ipConv(m_modbusCommSettings->slaveIP()), m_modbusCommSettings->TCPPort().toInt(),
+                 m_modbusCommSettings->slaveID(), 1, 0,
+                 m_modbusCommSettings->timeOut().toInt() * 1000, false);
 
 }
 
@@ -173,44 +195,48 @@ void Tools::modbusDiagnostics()
     //Modbus diagnostics - RTU/TCP
     QLOG_TRACE()<<  "Modbus diagnostics.";
 
-    //Modbus data
-    m_modbusAdapter->setFunctionCode(0x11);
-    uint8_t dest[1024]; //setup memory for data
-    memset(dest, 0, 1024);
-    int ret = -1; //return value from read functions
+    //Modbus data - the reply is handled in diagnosticsData
+    m_modbusAdapter->reportSlaveId(m_modbusCommSettings->slaveID());
+
+}
+
+void Tools::diagnosticsData(const ModbusResult &result)
+{
+
+    if (result.request.origin != ModbusRequest::Diagnostics)
+        return;
 
-    modbus_set_slave(m_modbusAdapter->m_modbus, m_modbusCommSettings->slaveID());
-    //request data from modbus
-    ret = modbus_report_slave_id(m_modbusAdapter->m_modbus, MODBUS_MAX_PDU_LENGTH, dest);
-    QLOG_TRACE() <<  "Modbus Read Data return value = " << ret << ", errno = " << errno;
+    int ret = result.ret; //return value from read functions
+    QLOG_TRACE() <<  "Modbus Read Data return value = " << ret << ", errno = " << result.error;
 
+    ui->txtOutput->moveCursor(QTextCursor::End);
     //update data model
     if(ret > 1)
     {
+        QByteArray dest;
+        for (int i = 0; i < result.data.size(); i++)
+            dest.append((char)result.data[i]);
         QString line;
         line = dest[1]?"ON":"OFF";
         ui->txtOutput->insertPlainText("Run Status : " + line + "\n");
-        QString id = QString::fromUtf8((char*)dest);
+        QString id = QString::fromUtf8(dest.constData());
         ui->txtOutput->insertPlainText("ID : " + id.right(id.size()-2) + "\n");;
     }
     else
     {
         QString line = "";
         if(ret < 0) {
-                line = QString("Error : ") +  EUtils::libmodbus_strerror(errno);
+                line = QString("Error : ") +  EUtils::libmodbus_strerror(result.error);
                 QLOG_ERROR() <<  "Read diagnostics data failed. " << line;
-                line = QString(tr("Read diagnostics data failed.\nError : ")) +  EUtils::libmodbus_strerror(errno);
+                line = QString(tr("Read diagnostics data failed.\nError : ")) +  EUtils::libmodbus_strerror(result.error);
                 ui->txtOutput->insertPlainText(line);
         }
         else {
-                line = QString("Unknown Error : ")  +  EUtils::libmodbus_strerror(errno);
+                line = QString("Unknown Error : ")  +  EUtils::libmodbus_strerror(result.error);
                 QLOG_ERROR() <<  "Read diagnostics data failed. " << line;
-                line = QString(tr("Read diagnostics data failed.\nUnknown Error : "))  +  EUtils::libmodbus_strerror(errno);
+                line = QString(tr("Read diagnostics data failed.\nUnknown Error : "))  +  EUtils::libmodbus_strerror(result.error);
                 ui->txtOutput->insertPlainText(line);
         }
-
-        modbus_flush(m_modbusAdapter->m_modbus); //flush data
      }
 
 }
-
@@ -2,12 +2,11 @@
 #define TOOLS_H
 
 #include <QMainWindow>
-#include <QProcess>
-#include <QTcpSocket>
 #include <qcombobox.h>
 
 #include "src/modbusadapter.h"
 #include "src/modbuscommsettings.h"
+#include "src/modbusping.h"
 
 namespace Ui {
 class Tools;
@@ -27,8 +26,8 @@ private:
     QComboBox *cmbCmd;
     ModbusAdapter *m_modbusAdapter;
     ModbusCommSettings *m_modbusCommSettings;
-    QProcess m_pingProc;
-    QTcpSocket m_portProc;
+    ModbusPing m_ping;
+    bool m_portCheck; //the ping is a port status check
     QString ipConv(QString ip);
     void pingProc();
     void portProc();
@@ -40,7 +39,9 @@ private slots:
     void changedModbusMode(int currIndex);
     void execCmd();
     void clear();
-    void pingData();
+    void pingRound(const PingRound &round);
+    void pingFinished();
+    void diagnosticsData(const ModbusResult &result);
 
 };
 
@@ -0,0 +1,95 @@
+#include <QDateTime>
+#include "trend.h"
+#include "ui_trend.h"
+
+#include "QsLog.h"
+
+//Time spans of the plot
+static const int Spans[] = {10000, 60000, 600000, 3600000}; //ms
+static const char *SpanNames[] = {"10 s", "1 min", "10 min", "1 h"};
+
+Trend::Trend(QWidget *parent, ModbusAdapter *adapter) :
+    QMainWindow(parent),
+    ui(new Ui::Trend),
+    m_modbusAdapter(adapter)
+{
+    //setup UI
+    ui->setupUi(this);
+    m_cmbSpan = new QComboBox(this);
+    for (unsigned int i = 0; i < sizeof(Spans) / sizeof(Spans[0]); ++i)
+        m_cmbSpan->addItem(SpanNames[i]);
+    m_cmbSpan->setCurrentIndex(1);
+    ui->trendWidget->setSpan(Spans[1]);
+    //the longest span is kept at 100 polls per second : 2^19 samples per series
+    ui->trendWidget->setMaxSpan(Spans[sizeof(Spans) / sizeof(Spans[0]) - 1]);
+    ui->toolBar->addWidget(m_cmbSpan);
+    ui->toolBar->addAction(ui->actionClear);
+    ui->toolBar->addAction(ui->actionExit);
+
+    //UI - connections
+    connect(ui->actionClear,SIGNAL(triggered()),this,SLOT(clear()));
+    connect(ui->actionExit,SIGNAL(triggered()),this,SLOT(exit()));
+    connect(m_cmbSpan,SIGNAL(currentIndexChanged(int)),this,SLOT(changedSpan(int)));
+    connect(m_modbusAdapter->regModel,SIGNAL(valuesUpdated()),this,SLOT(valuesUpdated()));
+    //other registers are read - the series no longer apply
+    connect(m_modbusAdapter->regModel,SIGNAL(modelReset()),this,SLOT(clear()));
+
+}
+
+Trend::~Trend()
+{
+    delete ui;
+}
+
+void Trend::addItems(const QList<int> &items)
+{
+
+    //One series per item not plotted yet
+
+    for (int i = 0; i < items.size(); ++i) {
+        if (items.at(i) < 0 || m_items.contains(items.at(i)))
+            continue;
+        QLOG_TRACE()<<  "Trend add item " << items.at(i);
+        m_items.append(items.at(i));
+        ui->trendWidget->addSeries(tr("Addr %1").arg(m_modbusAdapter->regModel->itemAddress(items.at(i))));
+    }
+
+}
+
+void Trend::valuesUpdated()
+{
+
+    //Sample the plotted items at each poll
+
+    if (m_items.isEmpty())
+        return;
+
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    RegistersModel *model = m_modbusAdapter->regModel;
+    for (int i = 0; i < m_items.size(); ++i) {
+        const int value = model->value(m_items.at(i));
+        if (value < 0)
+            continue;
+        ui->trendWidget->append(i, now, model->isSigned() ? (float)(int16_t)value : (float)value);
+    }
+
+}
+
+void Trend::changedSpan(int index)
+{
+    if (index >= 0)
+        ui->trendWidget->setSpan(Spans[index]);
+}
+
+void Trend::clear()
+{
+    m_items.clear();
+    ui->trendWidget->clear();
+}
+
+void Trend::exit()
+{
+
+   this->close();
+
+}
@@ -0,0 +1,37 @@
+#ifndef TREND_H
+#define TREND_H
+
+#include <QMainWindow>
+#include <QComboBox>
+#include <QList>
+
+#include "src/modbusadapter.h"
+
+namespace Ui {
+class Trend;
+}
+
+class Trend : public QMainWindow
+{
+    Q_OBJECT
+
+public:
+    explicit Trend(QWidget *parent = 0, ModbusAdapter *adapter = 0);
+    ~Trend();
+    void addItems(const QList<int> &items);
+
+private:
+    Ui::Trend *ui;
+    ModbusAdapter *m_modbusAdapter;
+    QComboBox *m_cmbSpan;
+    QList<int> m_items; //register model item of each series
+
+private slots:
+    void exit();
+    void clear();
+    void changedSpan(int index);
+    void valuesUpdated();
+
+};
+
+#endif // TREND_H
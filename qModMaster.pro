@@ -17,6 +17,11 @@ SOURCES += src/main.cpp \
     forms/settingsmodbusrtu.cpp \
     forms/settingsmodbustcp.cpp \
     src/modbusadapter.cpp \
+    src/modbusworker.cpp \
+    src/modbusscheduler.cpp \
+    src/modbuscoalescer.cpp \
+    src/modbuspipeline.cpp \
+    src/modbusconnectionpool.cpp \
     src/eutils.cpp \
     src/registersmodel.cpp \
     src/rawdatamodel.cpp \
@@ -33,7 +38,22 @@ SOURCES += src/main.cpp \
     3rdparty/QsLog/QsLogDestConsole.cpp \
     3rdparty/QsLog/QsLogDestFile.cpp \
     src/infobar.cpp \
-    forms/tools.cpp
+    forms/tools.cpp \
+    forms/scanlist.cpp \
+    forms/simulator.cpp \
+    forms/statistics.cpp \
+    src/modbusstatistics.cpp \
+    forms/trend.cpp \
+    forms/discovery.cpp \
+    src/modbusdiscovery.cpp \
+    src/modbusping.cpp \
+    src/modbuswritequeue.cpp \
+    src/modbustimeouts.cpp \
+    src/trendbuffer.cpp \
+    src/trendwidget.cpp \
+    src/historian.cpp \
+    src/modbussimulator.cpp \
+    src/headlessrunner.cpp
 
 HEADERS  += src/mainwindow.h \
     3rdparty/libmodbus/modbus.h \
@@ -41,6 +61,11 @@ HEADERS  += src/mainwindow.h \
     forms/settingsmodbusrtu.h \
     forms/settingsmodbustcp.h \
     src/modbusadapter.h \
+    src/modbusworker.h \
+    src/modbusscheduler.h \
+    src/modbuscoalescer.h \
+    src/modbuspipeline.h \
+    src/modbusconnectionpool.h \
     src/eutils.h \
     src/registersmodel.h \
     src/rawdatamodel.h \
@@ -56,7 +81,22 @@ HEADERS  += src/mainwindow.h \
     3rdparty/QsLog/QsLogDisableForThisFile.h \
     3rdparty/QsLog/QsLogDestFile.h \
     src/infobar.h \
-    forms/tools.h
+    forms/tools.h \
+    forms/scanlist.h \
+    forms/simulator.h \
+    forms/statistics.h \
+    src/modbusstatistics.h \
+    forms/trend.h \
+    forms/discovery.h \
+    src/modbusdiscovery.h \
+    src/modbusping.h \
+    src/modbuswritequeue.h \
+    src/modbustimeouts.h \
+    src/trendbuffer.h \
+    src/trendwidget.h \
+    src/historian.h \
+    src/modbussimulator.h \
+    src/headlessrunner.h
 
 INCLUDEPATH += 3rdparty/libmodbus \
     3rdparty/QsLog
@@ -78,7 +118,7 @@ QMAKE_CXXFLAGS += -std=gnu++11
 
 DEFINES += QS_LOG_LINE_NUMBERS     # automatically writes the file and line for each log message
 #DEFINES += QS_LOG_DISABLE         # logging code is replaced with a no-op
-#DEFINES += QS_LOG_SEPARATE_THREAD # messages are queued and written from a separate thread
+DEFINES += QS_LOG_SEPARATE_THREAD  # messages are queued and written from a separate thread
 #DEFINES += LIB_MODBUS_DEBUG_OUTPUT # enable debug output from libmodbus
 
 FORMS    += forms/mainwindow.ui \
@@ -87,7 +127,12 @@ FORMS    += forms/mainwindow.ui \
     forms/settingsmodbustcp.ui \
     forms/settings.ui \
     forms/busmonitor.ui \
-    forms/tools.ui
+    forms/tools.ui \
+    forms/scanlist.ui \
+    forms/simulator.ui \
+    forms/statistics.ui \
+    forms/trend.ui \
+    forms/discovery.ui
 
 RESOURCES += \
     icons/icons.qrc \
@@ -70,7 +70,7 @@ QString EUtils::libmodbus_strerror(int errnum)
             break;
 
         default://Default
-            return modbus_strerror(errno);
+            return modbus_strerror(errnum);
 
     }
 
@@ -2,6 +2,7 @@
 #define EUTILS_H
 
 #include <QString>
+#include <QStringList>
 #include <QMap>
 #include <QTime>
 #include "modbus.h"
@@ -11,6 +12,11 @@ static const QString ModbusFunctionNames[]={"Read Coils (0x01)","Read Discrete I
                                "Write Multiple Coils (0x0f)","Write Multiple Registers (0x10)","Report Server ID (0x11)"};
 static const int ModbusFunctionCodes[]={0x1,0x2,0x3,0x4,0x5,0x6,0xf,0x10,0x11};
 static const QString ModbusModeStamp[]={"[RTU]>","[TCP]>",""};
+#ifdef Q_OS_WIN32
+static const QStringList ModbusRTSModes = QStringList() << "Disable" << "Enable" << "HandShake" << "Toggle";
+#else
+static const QStringList ModbusRTSModes = QStringList() << "None" << "Up" << "Down";
+#endif
 
 class EUtils
 {
@@ -32,6 +38,7 @@ public:
                     case MODBUS_FC_READ_HOLDING_REGISTERS:
                     case MODBUS_FC_WRITE_SINGLE_REGISTER:
                     case MODBUS_FC_WRITE_MULTIPLE_REGISTERS:
+                    case MODBUS_FC_WRITE_AND_READ_REGISTERS:
                             return "Holding Register (16 bit)";
                     case MODBUS_FC_READ_INPUT_REGISTERS:
                             return "Input Register (16 bit)";
@@ -117,14 +124,14 @@ public:
             return ModbusFunctionCodes[index];
     }
 
-    static QString TxTimeStamp(int md)
+    static QString TxTimeStamp(int md, QTime time = QTime::currentTime())
     {
-        return (ModbusModeStamp[md] + "Tx > " + QTime::currentTime().toString("HH:mm:ss:zzz"));
+        return (ModbusModeStamp[md] + "Tx > " + time.toString("HH:mm:ss:zzz"));
     }
 
-    static QString RxTimeStamp(int md)
+    static QString RxTimeStamp(int md, QTime time = QTime::currentTime())
     {
-        return (ModbusModeStamp[md] + "Rx > " + QTime::currentTime().toString("HH:mm:ss:zzz"));
+        return (ModbusModeStamp[md] + "Rx > " + time.toString("HH:mm:ss:zzz"));
     }
 
     static QString SysTimeStamp()
@@ -138,6 +145,12 @@ public:
         return p.at(0);
     }
 
+    static int RTS(QString rts)
+    {
+        //the index is the libmodbus value (DCB RTS control on windows)
+        return qMax(0, ModbusRTSModes.indexOf(rts));
+    }
+
     static enum {RTU = 0, TCP = 1, None = 0} ModbusMode;
 
     static enum {Bin = 2, UInt = 10, Hex = 16} NumberFormat;
@@ -145,7 +158,8 @@ public:
     static enum {ReadCoils = 0x1, ReadDisInputs = 0x2,
                 ReadHoldRegs = 0x3, ReadInputRegs = 0x4,
                 WriteSingleCoil = 0x5, WriteSingleReg = 0x6,
-                WriteMultiCoils = 0xf, WriteMultiRegs = 0x10} FunctionCodes;
+                WriteMultiCoils = 0xf, WriteMultiRegs = 0x10,
+                WriteReadMultiRegs = 0x17} FunctionCodes;
 
     static QString formatValue(int value,int frmt, bool is16Bit, bool isSigned);
 
@@ -0,0 +1,167 @@
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QTimer>
+#include <stdio.h>
+#include "headlessrunner.h"
+#include "eutils.h"
+
+#include "QsLog.h"
+
+HeadlessRunner::HeadlessRunner(ModbusAdapter *adapter, ModbusCommSettings *settings, QObject *parent) :
+    QObject(parent),
+    m_modbus(adapter),
+    m_settings(settings)
+{
+    connect(m_modbus->scheduler,SIGNAL(entryUpdated(int,ModbusResult)),this,SLOT(entryUpdated(int,ModbusResult)));
+    connect(m_modbus,SIGNAL(errorMessage(QString)),this,SLOT(errorMessage(QString)));
+}
+
+bool HeadlessRunner::start(const QString &output, int duration)
+{
+
+    //Output : '-' or empty = stdout, else the file is appended
+    if (output.isEmpty() || output == "-") {
+        if (!m_file.open(stdout, QIODevice::WriteOnly)) {
+            fprintf(stderr, "Cannot open stdout\n");
+            return false;
+        }
+    }
+    else {
+        m_file.setFileName(output);
+        if (!m_file.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text)) {
+            fprintf(stderr, "Cannot open output file %s\n", qPrintable(output));
+            return false;
+        }
+    }
+    m_out.setDevice(&m_file);
+
+    m_entries = scanEntries();
+    if (m_entries.isEmpty()) {
+        fprintf(stderr, "Nothing to poll. The session has no scan list and no read request\n");
+        return false;
+    }
+
+    //the adapter connection is needed only by the entries without a device
+    for (int i = 0; i < m_entries.size(); ++i) {
+        if (m_entries.at(i).ip.isEmpty()) {
+            if (!connectDevice())
+                return false;
+            break;
+        }
+    }
+
+    QLOG_INFO()<<  "Headless polling started. Entries = " << m_entries.size();
+
+    m_out << "#time,entry,device,slave,function,start,count,status,values" << endl;
+    m_modbus->scheduler->setMaxGap(m_settings->maxGap().toInt());
+    m_modbus->scheduler->setEntries(m_entries);
+    m_modbus->scheduler->start();
+
+    if (duration > 0)
+        QTimer::singleShot(duration * 1000, this, SLOT(finish()));
+
+    return true;
+
+}
+
+QList<ScanEntry> HeadlessRunner::scanEntries()
+{
+
+    //The session scan list, else the read request of the session
+
+    QList<ScanEntry> entries = m_settings->scanList();
+    if (!entries.isEmpty())
+        return entries;
+
+    int functionCode = EUtils::ModbusFunctionCode(m_settings->functionCode());
+    if (EUtils::ModbusIsWriteFunction(functionCode) || functionCode == MODBUS_FC_REPORT_SLAVE_ID)
+        return entries;
+
+    ScanEntry entry;
+    entry.functionCode = functionCode;
+    entry.slave = m_settings->slaveID();
+    entry.startAddr = m_settings->startAddr() + m_settings->baseAddr().toInt();
+    entry.noOfItems = m_settings->noOfRegs();
+    entry.period = m_settings->scanRate();
+    entries.append(entry);
+
+    return entries;
+
+}
+
+bool HeadlessRunner::connectDevice()
+{
+
+    //Connection settings of the session
+
+    m_modbus->setTimeOut(m_settings->timeOut().toInt());
+    m_modbus->setAdaptiveTimeOut(m_settings->adaptiveTimeOut());
+    if (m_settings->modbusMode() == EUtils::RTU) {
+        m_modbus->modbusConnectRTU(m_settings->serialPortName(),
+                                   m_settings->baud().toInt(),
+                                   EUtils::parity(m_settings->parity()),
+                                   m_settings->dataBits().toInt(),
+                                   m_settings->stopBits().toInt(),
+                                   EUtils::RTS(m_settings->RTS()),
+                                   m_settings->timeOut().toInt());
+    }
+    else {
+        m_modbus->setPipelineDepth(m_settings->pipelineDepth().toInt());
+        m_modbus->modbusConnectTCP(m_settings->slaveIP(),
+                                   m_settings->TCPPort().toInt(),
+                                   m_settings->timeOut().toInt());
+    }
+
+    return m_modbus->isConnected();
+
+}
+
+void HeadlessRunner::entryUpdated(int index, const ModbusResult &result)
+{
+
+    //time,entry,device,slave,function,start,count,status,values
+
+    if (index >= m_entries.size())
+        return;
+
+    const ScanEntry &entry = m_entries.at(index);
+    QString line = QDateTime::currentDateTime().toString("yyyy-MM-ddTHH:mm:ss.zzz");
+    line += "," + QString::number(index);
+    line += "," + (entry.ip.isEmpty() ? QString("-") : entry.ip + ":" + QString::number(entry.port));
+    line += "," + QString::number(result.request.slave);
+    line += "," + QString::number(result.request.functionCode);
+    line += "," + QString::number(result.request.startAddr);
+    line += "," + QString::number(result.request.noOfItems);
+    if (result.ret == result.request.noOfItems) {
+        line += ",OK,";
+        for (int i = 0; i < result.data.size(); ++i) {
+            if (i > 0)
+                line += " ";
+            line += QString::number(result.data[i]);
+        }
+    }
+    else {
+        line += "," + EUtils::libmodbus_strerror(result.error).replace(',', ';') + ",";
+    }
+
+    //one line at a time - the output may be read through a pipe
+    m_out << line << endl;
+
+}
+
+void HeadlessRunner::errorMessage(QString message)
+{
+    fprintf(stderr, "%s\n", qPrintable(message.replace('\n', ' ')));
+}
+
+void HeadlessRunner::finish()
+{
+
+    QLOG_INFO()<<  "Headless polling finished";
+
+    m_modbus->scheduler->stop();
+    m_modbus->modbusDisConnect();
+    m_out.flush();
+    QCoreApplication::quit();
+
+}
@@ -0,0 +1,36 @@
+#ifndef HEADLESSRUNNER_H
+#define HEADLESSRUNNER_H
+
+#include <QObject>
+#include <QFile>
+#include <QTextStream>
+#include "modbusadapter.h"
+#include "modbuscommsettings.h"
+
+//Command line polling - runs the session scan list without the GUI
+//and writes one line per result to stdout or a file
+class HeadlessRunner : public QObject
+{
+    Q_OBJECT
+public:
+    explicit HeadlessRunner(ModbusAdapter *adapter, ModbusCommSettings *settings, QObject *parent = 0);
+
+    bool start(const QString &output, int duration);
+
+private slots:
+    void entryUpdated(int index, const ModbusResult &result);
+    void errorMessage(QString message);
+    void finish();
+
+private:
+    bool connectDevice();
+    QList<ScanEntry> scanEntries();
+    ModbusAdapter *m_modbus;
+    ModbusCommSettings *m_settings;
+    QList<ScanEntry> m_entries;
+    QFile m_file;
+    QTextStream m_out;
+
+};
+
+#endif // HEADLESSRUNNER_H
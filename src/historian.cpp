@@ -0,0 +1,499 @@
+#include "historian.h"
+
+#include <QDir>
+#include <QDateTime>
+#include <QRegExp>
+#include <QTextStream>
+#include <QtEndian>
+#include "QsLog.h"
+
+//'QMH1' and 'QMHB', little endian
+static const quint32 FileMagic = 0x31484d51;
+static const quint32 BlockMagic = 0x42484d51;
+static const int FileHeaderSize = 16; //magic, version, noOfItems, reserved
+static const int BlockHeaderSize = 32; //magic, size, rows, noOfItems, first time, last time
+static const quint32 FileVersion = 1;
+//partial blocks are written at this period - at most this much is lost on a crash
+static const int FlushInterval = 60000; //ms
+
+static void putVarint(QByteArray &out, quint64 value)
+{
+    while (value >= 0x80) {
+        out.append((char)((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    out.append((char)value);
+}
+
+static bool getVarint(const uchar *&p, const uchar *end, quint64 &value)
+{
+    value = 0;
+    for (int shift = 0; p < end && shift < 64; shift += 7) {
+        const uchar b = *p++;
+        value |= (quint64)(b & 0x7f) << shift;
+        if ((b & 0x80) == 0)
+            return true;
+    }
+    return false;
+}
+
+static quint64 zigzag(qint64 value)
+{
+    return ((quint64)value << 1) ^ (quint64)(value >> 63);
+}
+
+static qint64 unzigzag(quint64 value)
+{
+    return (qint64)(value >> 1) ^ -(qint64)(value & 1);
+}
+
+HistorianFile::HistorianFile(const QString &fileName, int noOfItems) :
+    m_file(fileName),
+    m_noOfItems(noOfItems)
+{
+}
+
+HistorianFile::~HistorianFile()
+{
+    flush();
+}
+
+QString HistorianFile::fileName() const
+{
+    return m_file.fileName();
+}
+
+qint64 HistorianFile::validLength(QFile &file, int *noOfItems)
+{
+
+    //Length of the header and of the complete blocks - a block cut by a
+    //crash is dropped, -1 if this is not a history file
+    //Only the headers are read : files grow past the 32 bit address space
+
+    const qint64 size = file.size();
+    uchar header[BlockHeaderSize];
+    if (size < FileHeaderSize || !file.seek(0) ||
+        file.read((char *)header, FileHeaderSize) != FileHeaderSize ||
+        qFromLittleEndian<quint32>(header) != FileMagic)
+        return -1;
+    *noOfItems = qFromLittleEndian<quint32>(header + 8);
+
+    qint64 pos = FileHeaderSize;
+    while (pos + BlockHeaderSize <= size) {
+        if (!file.seek(pos) || file.read((char *)header, BlockHeaderSize) != BlockHeaderSize)
+            break;
+        const quint32 blockSize = qFromLittleEndian<quint32>(header + 4);
+        if (qFromLittleEndian<quint32>(header) != BlockMagic ||
+            blockSize < (quint32)BlockHeaderSize || pos + blockSize > size)
+            break;
+        pos += blockSize;
+    }
+
+    return pos;
+
+}
+
+bool HistorianFile::open()
+{
+
+    //Append mode - a new file gets a header, a cut block is truncated
+
+    if (m_file.isOpen())
+        return true;
+
+    if (!m_file.open(QIODevice::ReadWrite)) {
+        QLOG_WARN() <<  "Historian cannot open " << m_file.fileName();
+        return false;
+    }
+
+    if (m_file.size() == 0) {
+        uchar header[FileHeaderSize];
+        qToLittleEndian<quint32>(FileMagic, header);
+        qToLittleEndian<quint32>(FileVersion, header + 4);
+        qToLittleEndian<quint32>(m_noOfItems, header + 8);
+        qToLittleEndian<quint32>(0, header + 12);
+        if (m_file.write((const char *)header, FileHeaderSize) != FileHeaderSize) {
+            m_file.close();
+            return false;
+        }
+        return true;
+    }
+
+    int noOfItems = 0;
+    const qint64 size = m_file.size();
+    const qint64 length = validLength(m_file, &noOfItems);
+    if (length < 0 || noOfItems != m_noOfItems) {
+        QLOG_WARN() <<  "Historian " << m_file.fileName() << " is not a history of this entry";
+        m_file.close();
+        return false;
+    }
+    if (length < size) {
+        QLOG_WARN() <<  "Historian " << m_file.fileName() << " truncated to its last complete block";
+        m_file.resize(length);
+    }
+    m_file.seek(length);
+
+    return true;
+
+}
+
+bool HistorianFile::append(qint64 time, bool valid, const QVector<uint16_t> &values)
+{
+
+    m_times.append(time);
+    m_valid.append(valid && values.size() == m_noOfItems ? 1 : 0);
+    for (int i = 0; i < m_noOfItems; ++i)
+        m_values.append(m_valid.last() ? values.at(i) : 0);
+
+    if (m_times.size() >= BlockRows)
+        return flush();
+    return true;
+
+}
+
+QByteArray HistorianFile::encodeBlock()
+{
+
+    const int rows = m_times.size();
+    QByteArray block(BlockHeaderSize, 0);
+
+    //time column : delta of delta, zigzag - 1 byte per poll for a steady period
+    qint64 prevDelta = 0;
+    for (int row = 1; row < rows; ++row) {
+        const qint64 delta = m_times.at(row) - m_times.at(row - 1);
+        putVarint(block, zigzag(delta - prevDelta));
+        prevDelta = delta;
+    }
+
+    //valid bitmap
+    QByteArray bitmap((rows + 7) / 8, 0);
+    for (int row = 0; row < rows; ++row)
+        if (m_valid.at(row))
+            bitmap[row / 8] = bitmap.at(row / 8) | (char)(1 << (row % 8));
+    block.append(bitmap);
+
+    //item columns, valid rows only : token = run of unchanged values << 1
+    //or changed bits << 1 | 1 - a constant item costs a few bytes per block
+    for (int item = 0; item < m_noOfItems; ++item) {
+        uint16_t prev = 0;
+        quint64 run = 0;
+        for (int row = 0; row < rows; ++row) {
+            if (!m_valid.at(row))
+                continue;
+            const uint16_t value = m_values.at(row * m_noOfItems + item);
+            if (value == prev) {
+                run++;
+                continue;
+            }
+            if (run > 0) {
+                putVarint(block, run << 1);
+                run = 0;
+            }
+            putVarint(block, ((quint64)(value ^ prev) << 1) | 1);
+            prev = value;
+        }
+        if (run > 0)
+            putVarint(block, run << 1);
+    }
+
+    uchar *header = (uchar *)block.data();
+    qToLittleEndian<quint32>(BlockMagic, header);
+    qToLittleEndian<quint32>(block.size(), header + 4);
+    qToLittleEndian<quint32>(rows, header + 8);
+    qToLittleEndian<quint32>(m_noOfItems, header + 12);
+    qToLittleEndian<qint64>(m_times.first(), header + 16);
+    qToLittleEndian<qint64>(m_times.last(), header + 24);
+
+    return block;
+
+}
+
+bool HistorianFile::flush()
+{
+
+    //Write the pending polls as one block
+
+    if (m_times.isEmpty())
+        return true;
+
+    QByteArray block = encodeBlock();
+    m_times.clear();
+    m_valid.clear();
+    m_values.clear();
+
+    if (!open())
+        return false;
+    if (m_file.write(block) != block.size()) {
+        QLOG_WARN() <<  "Historian write failed " << m_file.fileName();
+        return false;
+    }
+    m_file.flush();
+
+    return true;
+
+}
+
+bool HistorianFile::decodeBlock(const uchar *block, int size, qint64 from, qint64 to, HistorianSeries &series)
+{
+
+    const int rows = qFromLittleEndian<quint32>(block + 8);
+    const int noOfItems = series.noOfItems;
+    if (rows <= 0 || rows > BlockRows)
+        return false;
+    const uchar *p = block + BlockHeaderSize;
+    const uchar *end = block + size;
+    quint64 token;
+
+    //time column
+    QVector<qint64> times(rows);
+    times[0] = qFromLittleEndian<qint64>(block + 16);
+    qint64 delta = 0;
+    for (int row = 1; row < rows; ++row) {
+        if (!getVarint(p, end, token))
+            return false;
+        delta += unzigzag(token);
+        times[row] = times.at(row - 1) + delta;
+    }
+
+    //valid bitmap
+    const int bitmapSize = (rows + 7) / 8;
+    if (end - p < bitmapSize)
+        return false;
+    const uchar *bitmap = p;
+    p += bitmapSize;
+
+    //item columns
+    QVector<uint16_t> values(rows * noOfItems, 0);
+    for (int item = 0; item < noOfItems; ++item) {
+        uint16_t value = 0;
+        quint64 run = 0;
+        for (int row = 0; row < rows; ++row) {
+            if ((bitmap[row / 8] & (1 << (row % 8))) == 0)
+                continue;
+            if (run == 0) {
+                if (!getVarint(p, end, token))
+                    return false;
+                if (token & 1)
+                    value ^= (uint16_t)(token >> 1);
+                else
+                    run = (token >> 1) - 1;
+            }
+            else
+                run--;
+            values[row * noOfItems + item] = value;
+        }
+    }
+
+    //rows of the range
+    for (int row = 0; row < rows; ++row) {
+        if (times.at(row) < from || times.at(row) > to)
+            continue;
+        series.times.append(times.at(row));
+        series.valid.append((bitmap[row / 8] >> (row % 8)) & 1);
+        for (int item = 0; item < noOfItems; ++item)
+            series.values.append(values.at(row * noOfItems + item));
+    }
+
+    return true;
+
+}
+
+bool HistorianFile::query(const QString &fileName, qint64 from, qint64 to, HistorianSeries &series)
+{
+
+    //Read the polls in [from, to] - only the blocks in the range are read,
+    //the others are skipped from their header
+
+    series = HistorianSeries();
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly) || file.size() == 0)
+        return false;
+
+    int noOfItems = 0;
+    const qint64 length = validLength(file, &noOfItems);
+    bool ok = length >= 0;
+    series.noOfItems = noOfItems;
+
+    uchar header[BlockHeaderSize];
+    QByteArray block;
+    qint64 pos = FileHeaderSize;
+    while (ok && pos < length) {
+        ok = file.seek(pos) && file.read((char *)header, BlockHeaderSize) == BlockHeaderSize;
+        if (!ok)
+            break;
+        const int blockSize = qFromLittleEndian<quint32>(header + 4);
+        const qint64 first = qFromLittleEndian<qint64>(header + 16);
+        const qint64 last = qFromLittleEndian<qint64>(header + 24);
+        if (last >= from && first <= to &&
+            (int)qFromLittleEndian<quint32>(header + 12) == noOfItems) {
+            ok = file.seek(pos);
+            block = ok ? file.read(blockSize) : QByteArray();
+            ok = ok && block.size() == blockSize &&
+                 decodeBlock((const uchar *)block.constData(), blockSize, from, to, series);
+        }
+        pos += blockSize;
+    }
+
+    if (!ok)
+        QLOG_WARN() <<  "Historian corrupted file " << fileName;
+
+    return ok;
+
+}
+
+Historian::Historian(ModbusScheduler *scheduler, QObject *parent) :
+    QObject(parent),
+    m_scheduler(scheduler)
+{
+    m_enabled = false;
+    m_flushTimer = new QTimer(this);
+    connect(m_flushTimer,SIGNAL(timeout()),this,SLOT(flush()));
+    connect(m_scheduler,SIGNAL(entryUpdated(int,ModbusResult)),this,SLOT(entryUpdated(int,ModbusResult)));
+    connect(m_scheduler,SIGNAL(runningChanged(bool)),this,SLOT(runningChanged(bool)));
+}
+
+Historian::~Historian()
+{
+    closeAll();
+}
+
+void Historian::setEnabled(bool enabled)
+{
+
+    QLOG_INFO() <<  "Historian enabled = " << enabled;
+
+    m_enabled = enabled;
+    if (enabled)
+        m_flushTimer->start(FlushInterval);
+    else {
+        m_flushTimer->stop();
+        closeAll();
+    }
+
+}
+
+bool Historian::isEnabled()
+{
+    return m_enabled;
+}
+
+void Historian::setPath(const QString &path)
+{
+    if (path == m_path)
+        return;
+    closeAll();
+    m_path = path;
+}
+
+QString Historian::path()
+{
+    return m_path;
+}
+
+QString Historian::fileName(const ScanEntry &entry)
+{
+
+    //one file per device, slave, function and range - a changed entry
+    //starts a new history
+
+    QString device = entry.ip.isEmpty() ? QString("local") : entry.ip + "-" + QString::number(entry.port);
+    device.replace(QRegExp("[^A-Za-z0-9-]"), "-");
+    const QString name = QString("%1_s%2_fc%3_a%4_n%5.qmh").arg(device).arg(entry.slave)
+                         .arg(entry.functionCode, 2, 16, QChar('0')).arg(entry.startAddr).arg(entry.noOfItems);
+
+    return QDir(m_path).filePath(name);
+
+}
+
+void Historian::entryUpdated(int index, const ModbusResult &result)
+{
+
+    if (!m_enabled)
+        return;
+
+    QList<ScanEntry> entries = m_scheduler->entries();
+    if (index < 0 || index >= entries.size())
+        return;
+    const ScanEntry &entry = entries.at(index);
+
+    const QString name = fileName(entry);
+    HistorianFile *file = m_files.value(name);
+    if (file == NULL) {
+        QDir().mkpath(m_path);
+        file = new HistorianFile(name, entry.noOfItems);
+        m_files.insert(name, file);
+    }
+
+    file->append(QDateTime::currentMSecsSinceEpoch(), result.ret == entry.noOfItems, result.data);
+
+}
+
+void Historian::runningChanged(bool running)
+{
+    if (!running)
+        flush();
+}
+
+void Historian::flush()
+{
+    QHash<QString, HistorianFile *>::iterator it;
+    for (it = m_files.begin(); it != m_files.end(); ++it)
+        it.value()->flush();
+}
+
+void Historian::closeAll()
+{
+    qDeleteAll(m_files);
+    m_files.clear();
+}
+
+bool Historian::query(const ScanEntry &entry, qint64 from, qint64 to, HistorianSeries &series)
+{
+
+    const QString name = fileName(entry);
+    if (m_files.contains(name))
+        m_files.value(name)->flush();
+
+    return HistorianFile::query(name, from, to, series);
+
+}
+
+bool Historian::exportCSV(const ScanEntry &entry, const QString &fileName)
+{
+
+    //All the polls of the entry : time, status, one column per item
+
+    HistorianSeries series;
+    if (!query(entry, 0, Q_INT64_C(0x7fffffffffffffff), series))
+        return false;
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text))
+        return false;
+
+    QTextStream ts(&file);
+    ts << "time,status";
+    for (int item = 0; item < series.noOfItems; ++item)
+        ts << "," << entry.startAddr + item;
+    ts << endl;
+
+    for (int row = 0; row < series.rowCount(); ++row) {
+        ts << QDateTime::fromMSecsSinceEpoch(series.times.at(row)).toString(Qt::ISODate) << "."
+           << QString::number(series.times.at(row) % 1000).rightJustified(3, '0') << ","
+           << (series.valid.at(row) ? "OK" : "Error");
+        for (int item = 0; item < series.noOfItems; ++item) {
+            ts << ",";
+            if (series.valid.at(row))
+                ts << series.value(row, item);
+        }
+        ts << endl;
+    }
+
+    file.close();
+
+    QLOG_INFO() <<  "Historian exported " << series.rowCount() << " polls to " << fileName;
+
+    return true;
+
+}
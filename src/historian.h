@@ -0,0 +1,92 @@
+#ifndef HISTORIAN_H
+#define HISTORIAN_H
+
+#include <QObject>
+#include <QFile>
+#include <QHash>
+#include <QTimer>
+#include <QVector>
+#include <QString>
+#include "modbusscheduler.h"
+
+//Values of a time range, read back from a history file
+struct HistorianSeries
+{
+    HistorianSeries() : noOfItems(0) {}
+
+    int noOfItems;
+    QVector<qint64> times; //ms since epoch
+    QVector<quint8> valid; //0 : the poll failed, no values
+    QVector<uint16_t> values; //row major, noOfItems per row - 0 when not valid
+
+    int rowCount() const { return times.size(); }
+    uint16_t value(int row, int item) const { return values.at(row * noOfItems + item); }
+};
+
+//History of one scan entry : append-only file of compressed column blocks
+//File : header, then blocks of up to BlockRows polls. A block holds the
+//time column (delta of delta), the valid bitmap and one column per item
+//(xor with the previous value, runs of unchanged values in one token)
+class HistorianFile
+{
+public:
+    HistorianFile(const QString &fileName, int noOfItems);
+    ~HistorianFile();
+
+    enum {BlockRows = 3600};
+
+    bool open();
+    bool append(qint64 time, bool valid, const QVector<uint16_t> &values);
+    bool flush();
+    QString fileName() const;
+
+    //blocks outside [from, to] are skipped from their header
+    static bool query(const QString &fileName, qint64 from, qint64 to, HistorianSeries &series);
+
+private:
+    QByteArray encodeBlock();
+    static bool decodeBlock(const uchar *block, int size, qint64 from, qint64 to, HistorianSeries &series);
+    static qint64 validLength(QFile &file, int *noOfItems);
+    QFile m_file;
+    int m_noOfItems;
+    //polls not written yet
+    QVector<qint64> m_times;
+    QVector<quint8> m_valid;
+    QVector<uint16_t> m_values;
+
+};
+
+//Records every scan list result, one file per scan entry
+class Historian : public QObject
+{
+    Q_OBJECT
+public:
+    explicit Historian(ModbusScheduler *scheduler, QObject *parent = 0);
+    ~Historian();
+
+    void setEnabled(bool enabled);
+    bool isEnabled();
+    void setPath(const QString &path);
+    QString path();
+    QString fileName(const ScanEntry &entry);
+    bool query(const ScanEntry &entry, qint64 from, qint64 to, HistorianSeries &series);
+    bool exportCSV(const ScanEntry &entry, const QString &fileName);
+
+public slots:
+    void flush();
+
+private slots:
+    void entryUpdated(int index, const ModbusResult &result);
+    void runningChanged(bool running);
+
+private:
+    void closeAll();
+    ModbusScheduler *m_scheduler;
+    bool m_enabled;
+    QString m_path;
+    QHash<QString, HistorianFile *> m_files; //by file name
+    QTimer *m_flushTimer;
+
+};
+
+#endif // HISTORIAN_H
@@ -1,6 +1,9 @@
 #include <QApplication>
+#include <QCoreApplication>
+#include <QCommandLineParser>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <QDir>
 #include <QTranslator>
 
@@ -9,6 +12,7 @@
 #include "mainwindow.h"
 #include "modbusadapter.h"
 #include "modbuscommsettings.h"
+#include "headlessrunner.h"
 
 QTranslator *Translator;
 
@@ -21,8 +25,64 @@ QTranslator *Translator;
 //FatalLevel : 5
 //OffLevel : 6
 
+static bool isHeadless(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; ++i)
+        if (strcmp(argv[i], "--headless") == 0)
+            return true;
+    return false;
+}
+
+static int runHeadless(int argc, char *argv[])
+{
+
+    //Command line polling - no widgets, no display needed
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Polls the scan list of a session and writes the results");
+    parser.addHelpOption();
+    parser.addOption(QCommandLineOption("headless", "Run without the user interface."));
+    parser.addOption(QCommandLineOption("session", "Session file (*.ses) with the connection and the scan list.", "file"));
+    parser.addOption(QCommandLineOption("output", "Output file, appended. Default : stdout.", "file", "-"));
+    parser.addOption(QCommandLineOption("duration", "Stop after the given time. Default : run until killed.", "sec", "0"));
+    parser.process(app);
+
+    //init the logging mechanism - log file only, stdout has the results
+    QsLogging::Logger& logger = QsLogging::Logger::instance();
+    logger.setLoggingLevel(QsLogging::OffLevel);
+    const QString sLogPath(QDir(app.applicationDirPath()).filePath("QModMaster.log"));
+    QsLogging::DestinationPtr fileDestination(QsLogging::DestinationFactory::MakeFileDestination(sLogPath,true,65535,2));
+    logger.addDestination(fileDestination);
+
+    //Program settings, overridden by the session
+    ModbusCommSettings settings("qModMaster.ini");
+    if (parser.isSet("session")) {
+        if (!QFile::exists(parser.value("session"))) {
+            fprintf(stderr, "Session file %s not found\n", qPrintable(parser.value("session")));
+            return 1;
+        }
+        settings.loadSession(parser.value("session"));
+    }
+    logger.setLoggingLevel((QsLogging::Level)settings.loggingLevel());
+
+    ModbusAdapter modbus_adapt(NULL);
+    modbus_adapt.historian->setPath(settings.historyPath());
+    modbus_adapt.historian->setEnabled(settings.history());
+    HeadlessRunner runner(&modbus_adapt, &settings);
+    if (!runner.start(parser.value("output"), parser.value("duration").toInt()))
+        return 1;
+
+    return app.exec();
+
+}
+
 int main(int argc, char *argv[])
 {
+
+    if (isHeadless(argc, argv))
+        return runHeadless(argc, argv);
+
     QApplication app(argc, argv);
     QApplication::setAttribute(Qt::AA_EnableHighDpiScaling);
     Translator = new QTranslator;
@@ -45,6 +45,17 @@ MainWindow::MainWindow(QWidget *parent, ModbusAdapter *adapter, ModbusCommSettin
     connect(ui->actionBus_Monitor,SIGNAL(triggered()),this,SLOT(showBusMonitor()));
     m_tools = new Tools(this, m_modbus, m_modbusCommSettings);
     connect(ui->actionTools,SIGNAL(triggered()),this,SLOT(showTools()));
+    m_scanList = new ScanList(this, m_modbus, m_modbusCommSettings);
+    m_modbus->scheduler->setMaxGap(m_modbusCommSettings->maxGap().toInt());
+    connect(ui->actionScan_List,SIGNAL(triggered()),this,SLOT(showScanList()));
+    m_simulator = new Simulator(this);
+    connect(ui->actionSimulator,SIGNAL(triggered()),this,SLOT(showSimulator()));
+    m_statistics = new Statistics(this, m_modbus);
+    connect(ui->actionStatistics,SIGNAL(triggered()),this,SLOT(showStatistics()));
+    m_trend = new Trend(this, m_modbus);
+    connect(ui->actionTrend,SIGNAL(triggered()),this,SLOT(showTrend()));
+    m_discovery = new Discovery(this, m_modbus, m_modbusCommSettings);
+    connect(ui->actionDiscovery,SIGNAL(triggered()),this,SLOT(showDiscovery()));
 
     //UI - connections
     connect(ui->cmbModbusMode,SIGNAL(currentIndexChanged(int)),this,SLOT(changedModbusMode(int)));
@@ -98,6 +109,7 @@ MainWindow::MainWindow(QWidget *parent, ModbusAdapter *adapter, ModbusCommSettin
     ui->mainToolBar->addAction(ui->actionOpenLogFile);
     ui->mainToolBar->addAction(ui->actionBus_Monitor);
     ui->mainToolBar->addAction(ui->actionTools);
+    ui->mainToolBar->addAction(ui->actionScan_List);
     ui->mainToolBar->addAction(ui->actionHeaders);
     ui->mainToolBar->addSeparator();
     ui->mainToolBar->addAction(ui->actionSerial_RTU);
@@ -110,7 +122,16 @@ MainWindow::MainWindow(QWidget *parent, ModbusAdapter *adapter, ModbusCommSettin
 
     //Init models
     ui->tblRegisters->setItemDelegate(m_modbus->regModel->itemDelegate());
-    ui->tblRegisters->setModel(m_modbus->regModel->model);
+    ui->tblRegisters->setModel(m_modbus->regModel);
+    connect(m_modbus,SIGNAL(errorMessage(QString)),this,SLOT(showErrorMessage(QString)));
+    connect(m_modbus,SIGNAL(errorCleared()),this,SLOT(hideInfoBar()));
+    //columns are resized when the layout or the format changes, not on every poll
+    connect(m_modbus->regModel,SIGNAL(refreshView()),this,SLOT(resizeView()));
+    m_modbus->regModel->setHighlightChanges(m_modbusCommSettings->highlightChanges());
+    m_modbus->historian->setPath(m_modbusCommSettings->historyPath());
+    m_modbus->historian->setEnabled(m_modbusCommSettings->history());
+    m_modbus->setVerifyWrites(m_modbusCommSettings->verifyWrites());
+    m_modbus->setAdaptiveTimeOut(m_modbusCommSettings->adaptiveTimeOut());
     ui->tblRegisters->horizontalHeader()->hide();
     ui->tblRegisters->verticalHeader()->hide();
     changedBase(m_modbusCommSettings->base());
@@ -177,6 +198,11 @@ void MainWindow::showSettings()
         QLOG_TRACE()<<  "Settings changes accepted ";
         m_modbus->rawModel->setMaxNoOfLines(m_modbusCommSettings->maxNoOfLines().toInt());
         m_modbus->setTimeOut(m_modbusCommSettings->timeOut().toInt());
+        m_modbus->scheduler->setMaxGap(m_modbusCommSettings->maxGap().toInt());
+        m_modbus->regModel->setHighlightChanges(m_modbusCommSettings->highlightChanges());
+        m_modbus->historian->setEnabled(m_modbusCommSettings->history());
+        m_modbus->setVerifyWrites(m_modbusCommSettings->verifyWrites());
+        m_modbus->setAdaptiveTimeOut(m_modbusCommSettings->adaptiveTimeOut());
         m_modbusCommSettings->saveSettings();
     }
     else
@@ -207,6 +233,62 @@ void MainWindow::showTools()
 
 }
 
+void MainWindow::showDiscovery()
+{
+
+    //Show Discovery
+
+    m_discovery->move(this->x() + this->width() + 40, this->y() + 40);
+    m_discovery->show();
+
+}
+
+void MainWindow::showScanList()
+{
+
+    //Show Scan List
+
+    m_scanList->move(this->x() + this->width() + 60, this->y() + 40);
+    m_scanList->show();
+
+}
+
+void MainWindow::showSimulator()
+{
+
+    //Show Slave Simulator
+
+    m_simulator->move(this->x() + this->width() + 80, this->y() + 60);
+    m_simulator->show();
+
+}
+
+void MainWindow::showStatistics()
+{
+
+    //Show Statistics
+
+    m_statistics->move(this->x() + this->width() + 20, this->y() + 80);
+    m_statistics->show();
+
+}
+
+void MainWindow::showTrend()
+{
+
+    //Show Trend of the selected registers
+
+    QList<int> items;
+    QModelIndexList selected = ui->tblRegisters->selectionModel()->selectedIndexes();
+    for (int i = 0; i < selected.size(); ++i)
+        items.append(m_modbus->regModel->itemIndex(selected.at(i)));
+    m_trend->addItems(items);
+
+    m_trend->move(this->x() + this->width() + 40, this->y() + 100);
+    m_trend->show();
+
+}
+
 void MainWindow::changedModbusMode(int currIndex)
 {
 
@@ -245,25 +327,25 @@ void MainWindow::changedFunctionCode(int currIndex)
         case MODBUS_FC_READ_COILS:
                 m_modbus->regModel->setIs16Bit(false);
                 ui->sbNoOfRegs->setEnabled(true);
-                ui->sbNoOfRegs->setMaximum(2000);
+                ui->sbNoOfRegs->setMaximum(MaxAddressSpace);
                 ui->lblNoOfCoils->setText(String_number_of_coils);
                 break;
         case MODBUS_FC_READ_DISCRETE_INPUTS:
                 m_modbus->regModel->setIs16Bit(false);
                 ui->sbNoOfRegs->setEnabled(true);
-                ui->sbNoOfRegs->setMaximum(2000);
+                ui->sbNoOfRegs->setMaximum(MaxAddressSpace);
                 ui->lblNoOfCoils->setText(String_number_of_inputs);
                 break;
         case MODBUS_FC_READ_HOLDING_REGISTERS:
                 m_modbus->regModel->setIs16Bit(true);
                 ui->sbNoOfRegs->setEnabled(true);
-                ui->sbNoOfRegs->setMaximum(125);
+                ui->sbNoOfRegs->setMaximum(MaxAddressSpace);
                 ui->lblNoOfCoils->setText(String_number_of_registers);
                 break;
         case MODBUS_FC_READ_INPUT_REGISTERS:
                 m_modbus->regModel->setIs16Bit(true);
                 ui->sbNoOfRegs->setEnabled(true);
-                ui->sbNoOfRegs->setMaximum(125);
+                ui->sbNoOfRegs->setMaximum(MaxAddressSpace);
                 ui->lblNoOfCoils->setText(String_number_of_registers);
                 break;
         case MODBUS_FC_WRITE_SINGLE_COIL:
@@ -540,7 +622,7 @@ void MainWindow::modbusRequest()
 {
 
      //Request items from modbus adapter and add raw data to raw data model
-    int rowCount = m_modbus->regModel->model->rowCount();
+    int rowCount = m_modbus->regModel->rowCount();
     int baseAddr;
 
     QLOG_TRACE()<<  "Request transaction. No or registers = " <<  rowCount;
@@ -571,7 +653,7 @@ void MainWindow::modbusScanCycle(bool value)
 {
 
    //Request items from modbus adapter and add raw data to raw data model
-   int rowCount = m_modbus->regModel->model->rowCount();
+   int rowCount = m_modbus->regModel->rowCount();
    int baseAddr;
 
    if (value && rowCount == 0) {
@@ -634,11 +716,12 @@ void MainWindow::modbusConnect(bool connect)
                                         EUtils::parity(m_modbusCommSettings->parity()),
                                         m_modbusCommSettings->dataBits().toInt(),
                                         m_modbusCommSettings->stopBits().toInt(),
-                                        m_modbusCommSettings->RTS().toInt(),
+                                        EUtils::RTS(m_modbusCommSettings->RTS()),
                                         m_modbusCommSettings->timeOut().toInt()
                                         );
         }
         else { //TCP
+            m_modbus->setPipelineDepth(m_modbusCommSettings->pipelineDepth().toInt());
             m_modbus->modbusConnectTCP(m_modbusCommSettings->slaveIP(),
                                        m_modbusCommSettings->TCPPort().toInt(),
                                        m_modbusCommSettings->timeOut().toInt());
@@ -680,13 +763,19 @@ void MainWindow::showHeaders(bool value)
  {
 
      QLOG_TRACE()<<  "Packets sent / received = " << m_modbus->packets() << ", errors = " << m_modbus->errors();
-     ui->tblRegisters->resizeColumnsToContents();
 
      m_statusPackets->setText(tr("Packets : ") + QString("%1").arg(m_modbus->packets()));
      m_statusErrors->setText(tr("Errors : ") + QString("%1").arg(m_modbus->errors()));
 
  }
 
+ void MainWindow::resizeView()
+ {
+
+     ui->tblRegisters->resizeColumnsToContents();
+
+ }
+
 void MainWindow::loadSession()
 {
 QString fName;
@@ -708,6 +797,7 @@ QString fName;
          ui->spInterval->setValue(m_modbusCommSettings->scanRate());
          ui->sbStartAddress->setValue(m_modbusCommSettings->startAddr());
          ui->sbNoOfRegs->setValue(m_modbusCommSettings->noOfRegs());
+         m_scanList->reload();
          updateStatusBar();
          refreshView();
          QMessageBox::information(this, "QModMaster", "Load session file : " + fName);
@@ -746,6 +836,11 @@ void MainWindow::hideInfoBar()
     ui->infobar->hide();
 }
 
+void MainWindow::showErrorMessage(QString message)
+{
+    showUpInfoBar(message, InfoBar::Error);
+}
+
 void MainWindow::changeEvent(QEvent* event)
 {
     if(event->type() == QEvent::LanguageChange)
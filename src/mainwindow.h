@@ -13,6 +13,11 @@
 #include "forms/settings.h"
 #include "forms/busmonitor.h"
 #include "forms/tools.h"
+#include "forms/scanlist.h"
+#include "forms/simulator.h"
+#include "forms/statistics.h"
+#include "forms/trend.h"
+#include "forms/discovery.h"
 #include "modbuscommsettings.h"
 #include "modbusadapter.h"
 #include "infobar.h"
@@ -29,7 +34,10 @@ public:
     explicit MainWindow(QWidget *parent = 0, ModbusAdapter *adapter = 0, ModbusCommSettings *settings = 0);
     ~MainWindow();
     void showUpInfoBar(QString message, InfoBar::InfoType type);
+
+public slots:
     void hideInfoBar();
+    void showErrorMessage(QString message);
 
 private:
     Ui::MainWindow *ui;
@@ -40,6 +48,11 @@ private:
     Settings *m_dlgSettings;
     BusMonitor *m_busMonitor;
     Tools *m_tools;
+    ScanList *m_scanList;
+    Simulator *m_simulator;
+    Statistics *m_statistics;
+    Trend *m_trend;
+    Discovery *m_discovery;
 
     ModbusCommSettings *m_modbusCommSettings;
     void updateStatusBar();
@@ -59,6 +72,11 @@ private slots:
     void showSettings();
     void showBusMonitor();
     void showTools();
+    void showScanList();
+    void showSimulator();
+    void showStatistics();
+    void showTrend();
+    void showDiscovery();
     void changedModbusMode(int currIndex);
     void changedFunctionCode(int currIndex);
     void changedBase(int currIndex);
@@ -75,6 +93,7 @@ private slots:
     void modbusScanCycle(bool value);
     void modbusRequest();
     void refreshView();
+    void resizeView();
     void changeLanguage();
     void openModbusManual();
     void loadSession();
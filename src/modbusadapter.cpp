@@ -1,87 +1,103 @@
-#include <QApplication>
 #include <QtDebug>
 #include "modbusadapter.h"
-#include "mainwindow.h"
 
 #include "QsLog.h"
 #include <errno.h>
 
-ModbusAdapter *m_instance;
+//written registers wait this long for a scan list read of their slave (FC 0x17)
+static const int PairWindow = 200; //ms
 
 ModbusAdapter::ModbusAdapter(QObject *parent) :
-    QObject(parent),
-    m_modbus(NULL)
+    QObject(parent)
 {
-    m_instance = this;
     regModel=new RegistersModel(this);
     rawModel=new RawDataModel(this);
+    scheduler=new ModbusScheduler(this, this);
+    historian=new Historian(scheduler, this);
     m_connected = false;
     m_ModBusMode = EUtils::None;
     m_pollTimer = new QTimer(this);
     m_timeOut = 0;
+    m_pipelineDepth = 1;
     m_transactionIsPending = false;
+    m_pendingRequests = 0;
+    m_verifyWrites = false;
     m_packets = 0;
     m_errors = 0;
     connect(m_pollTimer,SIGNAL(timeout()),this,SLOT(modbusTransaction()));
-    connect(regModel,SIGNAL(refreshView()),this,SIGNAL(refreshView()));
-    //setup memory for data
-    dest = (uint8_t *) malloc(2000 * sizeof(uint8_t));
-    memset(dest, 0, 2000 * sizeof(uint8_t));
-    dest16 = (uint16_t *) malloc(125 * sizeof(uint16_t));
-    memset(dest16, 0, 125 * sizeof(uint16_t));
+    m_pairTimer = new QTimer(this);
+    m_pairTimer->setSingleShot(true);
+    connect(m_pairTimer,SIGNAL(timeout()),this,SLOT(sendCommittedWrites()));
+    connect(regModel,SIGNAL(valueEdited(int)),this,SLOT(valueEdited(int)));
+    //I/O worker - owns the libmodbus context
+    qRegisterMetaType<ModbusResult>("ModbusResult");
+    qRegisterMetaType<QList<ModbusResult> >("QList<ModbusResult>");
+    m_workerThread = new QThread(this);
+    //transaction timing, recorded by the workers
+    statistics = new ModbusStatistics();
+    m_worker = new ModbusWorker();
+    m_worker->setStatistics(statistics);
+    m_worker->moveToThread(m_workerThread);
+    connect(m_worker,SIGNAL(resultsReady(QList<ModbusResult>)),this,SLOT(resultsReady(QList<ModbusResult>)));
+    m_workerThread->start();
+    //TCP devices of the scan list
+    m_pool = new ModbusConnectionPool(this);
+    m_pool->setStatistics(statistics);
+    connect(m_pool,SIGNAL(resultsReady(QList<ModbusResult>)),this,SLOT(resultsReady(QList<ModbusResult>)));
 }
 
 ModbusAdapter::~ModbusAdapter()
 {
-    free(dest);
-    free(dest16);
+    m_worker->clearQueue();
+    m_workerThread->quit();
+    m_workerThread->wait();
+    delete m_worker;
+    //the pool threads record statistics until they stop
+    delete m_pool;
+    delete statistics;
 }
 
 void ModbusAdapter::modbusConnectRTU(QString port, int baud, QChar parity, int dataBits, int stopBits, int RTS, int timeOut)
 {
     //Modbus RTU connect
     QString line;
+    int status = ModbusWorker::ContextError;
     modbusDisConnect();
 
     QLOG_INFO()<<  "Modbus Connect RTU";
 
-    m_modbus = modbus_new_rtu(port.toLatin1().constData(),baud,parity.toLatin1(),dataBits,stopBits,RTS);
     line = "Connecting to Serial Port [" + port + "]...";
     QLOG_TRACE() <<  line;
 
-    //Debug messages from libmodbus
-    #ifdef LIB_MODBUS_DEBUG_OUTPUT
-        modbus_set_debug(m_modbus, 1);
-    #endif
-
     m_timeOut = timeOut;
+    m_pool->setTimeOut(timeOut);
+
+    //one transaction at a time on a serial line
+    QMetaObject::invokeMethod(m_worker, "setPipelineDepth", Qt::QueuedConnection, Q_ARG(int, 1));
+    scheduler->setMaxInFlight(1);
+
+    //the worker owns the context, wait for the connection result
+    QMetaObject::invokeMethod(m_worker, "connectRTU", Qt::BlockingQueuedConnection,
+                              Q_RETURN_ARG(int, status),
+                              Q_ARG(QString, port), Q_ARG(int, baud), Q_ARG(QChar, parity),
+                              Q_ARG(int, dataBits), Q_ARG(int, stopBits), Q_ARG(int, RTS),
+                              Q_ARG(int, timeOut));
 
-    if(m_modbus == NULL){
-        mainWin->showUpInfoBar(tr("Unable to create the libmodbus context."), InfoBar::Error);
+    if(status == ModbusWorker::ContextError){
+        emit(errorMessage(tr("Unable to create the libmodbus context.")));
         QLOG_ERROR()<<  "Connection failed. Unable to create the libmodbus context";
         return;
     }
-    else if(m_modbus && modbus_set_slave(m_modbus, m_slave) == -1){
-        modbus_free(m_modbus);
-        mainWin->showUpInfoBar(tr("Invalid slave ID."), InfoBar::Error);
-        QLOG_ERROR()<<  "Connection failed. Invalid slave ID";
-        return;
-    }
-    else if(m_modbus && modbus_connect(m_modbus) == -1) {
-        modbus_free(m_modbus);
-        mainWin->showUpInfoBar(tr("Connection failed\nCould not connect to serial port."), InfoBar::Error);
+    else if(status == ModbusWorker::ConnectError) {
+        emit(errorMessage(tr("Connection failed\nCould not connect to serial port.")));
         QLOG_ERROR()<<  "Connection failed. Could not connect to serial port";
         m_connected = false;
         line += "Failed";
     }
     else {
-        //error recovery mode
-        modbus_set_error_recovery(m_modbus, MODBUS_ERROR_RECOVERY_PROTOCOL);
-        //response_timeout;
-        modbus_set_response_timeout(m_modbus, timeOut, 0);
         m_connected = true;
         line += "OK";
-        mainWin->hideInfoBar();
+        emit(errorCleared());
         QLOG_TRACE() << line;
     }
 
@@ -98,6 +114,7 @@ void ModbusAdapter::modbusConnectTCP(QString ip, int port, int timeOut)
     //Modbus TCP connect
     QString strippedIP = "";
     QString line;
+    int status = ModbusWorker::ContextError;
     modbusDisConnect();
 
     QLOG_INFO()<<  "Modbus Connect TCP";
@@ -106,43 +123,42 @@ void ModbusAdapter::modbusConnectTCP(QString ip, int port, int timeOut)
     QLOG_TRACE() <<  line;
     strippedIP = stripIP(ip);
     if (strippedIP == ""){
-        mainWin->showUpInfoBar(tr("Connection failed\nBlank IP Address."), InfoBar::Error);
+        emit(errorMessage(tr("Connection failed\nBlank IP Address.")));
         QLOG_ERROR()<<  "Connection failed. Blank IP Address";
         return;
     }
     else {
-        m_modbus = modbus_new_tcp(strippedIP.toLatin1().constData(), port);
-        mainWin->hideInfoBar();
+        emit(errorCleared());
         QLOG_TRACE() <<  "Connecting to IP : " << ip << ":" << port;
     }
 
-    //Debug messages from libmodbus
-    #ifdef LIB_MODBUS_DEBUG_OUTPUT
-        modbus_set_debug(m_modbus, 1);
-    #endif
-
     m_timeOut = timeOut;
+    m_pool->setTimeOut(timeOut);
 
-    if(m_modbus == NULL){
-        mainWin->showUpInfoBar(tr("Unable to create the libmodbus context."), InfoBar::Error);
+    //requests in flight on the TCP connection
+    QMetaObject::invokeMethod(m_worker, "setPipelineDepth", Qt::QueuedConnection, Q_ARG(int, m_pipelineDepth));
+    scheduler->setMaxInFlight(m_pipelineDepth);
+
+    //the worker owns the context, wait for the connection result
+    QMetaObject::invokeMethod(m_worker, "connectTCP", Qt::BlockingQueuedConnection,
+                              Q_RETURN_ARG(int, status),
+                              Q_ARG(QString, strippedIP), Q_ARG(int, port), Q_ARG(int, timeOut));
+
+    if(status == ModbusWorker::ContextError){
+        emit(errorMessage(tr("Unable to create the libmodbus context.")));
         QLOG_ERROR()<<  "Connection failed. Unable to create the libmodbus context";
         return;
     }
-    else if(m_modbus && modbus_connect(m_modbus) == -1) {
-        modbus_free(m_modbus);
-        mainWin->showUpInfoBar(tr("Connection failed\nCould not connect to TCP port."), InfoBar::Error);
+    else if(status == ModbusWorker::ConnectError) {
+        emit(errorMessage(tr("Connection failed\nCould not connect to TCP port.")));
         QLOG_ERROR()<<  "Connection to IP : " << ip << ":" << port << "...failed. Could not connect to TCP port";
         m_connected = false;
         line += " Failed";
     }
     else {
-        //error recovery mode
-        modbus_set_error_recovery(m_modbus, MODBUS_ERROR_RECOVERY_PROTOCOL);
-        //response_timeout;
-        modbus_set_response_timeout(m_modbus, timeOut, 0);
         m_connected = true;
         line += " OK";
-        mainWin->hideInfoBar();
+        emit(errorCleared());
         QLOG_TRACE() << line;
     }
 
@@ -161,13 +177,17 @@ void ModbusAdapter::modbusDisConnect()
 
     QLOG_INFO()<<  "Modbus disconnected";
 
-    if(m_modbus) {
-        if (m_connected){
-            modbus_close(m_modbus);
-            modbus_free(m_modbus);
-        }
-        m_modbus = NULL;
-    }
+    scheduler->stop();
+    //drop queued requests and wait for the current transaction to finish
+    m_worker->clearQueue();
+    QMetaObject::invokeMethod(m_worker, "disconnectDevice", Qt::BlockingQueuedConnection);
+    m_pool->disconnectAll();
+    scheduler->requestsDropped();
+    m_transactionIsPending = false;
+    m_pendingRequests = 0;
+    m_noWriteRead.clear();
+    m_committedWrites.clear();
+    m_pairTimer->stop();
 
     m_connected = false;
 
@@ -187,9 +207,14 @@ void ModbusAdapter::modbusTransaction()
     //Modbus request data
 
     QLOG_INFO() <<  "Modbus Transaction. Function Code = " << m_functionCode;
-    m_packets += 1;
 
-    QApplication::setOverrideCursor(Qt::WaitCursor);
+    //the bus is slower than the scan rate - do not pile up requests
+    if (m_transactionIsPending) {
+        QLOG_WARN() <<  "Modbus Transaction skipped. Previous transaction is pending";
+        return;
+    }
+
+    m_packets += 1;
 
     switch(m_functionCode)
     {
@@ -210,8 +235,6 @@ void ModbusAdapter::modbusTransaction()
                     break;
     }
 
-    QApplication::setOverrideCursor(Qt::ArrowCursor);
-
     emit(refreshView());
 
 }
@@ -221,48 +244,32 @@ void ModbusAdapter::modbusReadData(int slave, int functionCode, int startAddress
 
     QLOG_INFO() <<  "Modbus Read Data ";
 
-    if(m_modbus == NULL) return;
-
-    int ret = -1; //return value from read functions
-    bool is16Bit = false;
+    if(!m_connected) return;
 
-    modbus_set_slave(m_modbus, slave);
-    //request data from modbus
-    switch(functionCode)
-    {
-            case MODBUS_FC_READ_COILS:
-                    ret = modbus_read_bits(m_modbus, startAddress, noOfItems, dest);
-                    break;
+    ModbusRequest request;
+    request.origin = ModbusRequest::Poll;
+    request.slave = slave;
+    request.functionCode = functionCode;
+    request.startAddr = startAddress;
+    request.noOfItems = noOfItems;
 
-            case MODBUS_FC_READ_DISCRETE_INPUTS:
-                    ret = modbus_read_input_bits(m_modbus, startAddress, noOfItems, dest);
-                    break;
-
-            case MODBUS_FC_READ_HOLDING_REGISTERS:
-                    ret = modbus_read_registers(m_modbus, startAddress, noOfItems, dest16);
-                    is16Bit = true;
-                    break;
+    m_transactionIsPending = true;
+    m_pendingRequests = 1;
+    m_worker->enqueue(request);
 
-            case MODBUS_FC_READ_INPUT_REGISTERS:
-                    ret = modbus_read_input_registers(m_modbus, startAddress, noOfItems, dest16);
-                    is16Bit = true;
-                    break;
+}
 
-            default:
-                    break;
-    }
+void ModbusAdapter::readDataDone(const ModbusResult &result)
+{
 
-    QLOG_TRACE() <<  "Modbus Read Data return value = " << ret << ", errno = " << errno;
+    int ret = result.ret;
+    int noOfItems = result.request.noOfItems;
 
     //update data model
     if(ret == noOfItems)
     {
-            for(int i = 0; i < noOfItems; ++i)
-            {
-                int data = is16Bit ? dest16[i] : dest[i];
-                regModel->setValue(i,data);
-            }
-            mainWin->hideInfoBar();
+            regModel->setValues(result.data);
+            emit(errorCleared());
     }
     else
     {
@@ -272,20 +279,19 @@ void ModbusAdapter::modbusReadData(int slave, int functionCode, int startAddress
 
         QString line = "";
         if(ret < 0) {
-                line = QString("Error : ") +  EUtils::libmodbus_strerror(errno);
+                line = QString("Error : ") +  EUtils::libmodbus_strerror(result.error);
                 QLOG_ERROR() <<  "Read Data failed. " << line;
                 rawModel->addLine(EUtils::SysTimeStamp() + " - " + line);
-                line = QString(tr("Read data failed.\nError : ")) +  EUtils::libmodbus_strerror(errno);
+                line = QString(tr("Read data failed.\nError : ")) +  EUtils::libmodbus_strerror(result.error);
         }
         else {
-                line = QString("Number of registers returned does not match number of registers requested!. Error : ")  +  EUtils::libmodbus_strerror(errno);
+                line = QString("Number of registers returned does not match number of registers requested!. Error : ")  +  EUtils::libmodbus_strerror(result.error);
                 QLOG_ERROR() <<  "Read Data failed. " << line;
                 rawModel->addLine(EUtils::SysTimeStamp() + " - " + line);
-                line = QString(tr("Read data failed.\nNumber of registers returned does not match number of registers requested!. Error : "))  +  EUtils::libmodbus_strerror(errno);
+                line = QString(tr("Read data failed.\nNumber of registers returned does not match number of registers requested!. Error : "))  +  EUtils::libmodbus_strerror(result.error);
         }
 
-        mainWin->showUpInfoBar(line, InfoBar::Error);
-        modbus_flush(m_modbus); //flush data
+        emit(errorMessage(line));
      }
 
 }
@@ -295,122 +301,302 @@ void ModbusAdapter::modbusWriteData(int slave, int functionCode, int startAddres
 
     QLOG_INFO() <<  "Modbus Write Data ";
 
-    if(m_modbus == NULL) return;
-
-    int ret = -1; //return value from functions
+    if(!m_connected) return;
+
+    //only the edited cells, in the fewest requests
+    if (m_writeQueue.count() > 0) {
+        QList<ModbusRequest> requests = m_writeQueue.take(m_verifyWrites);
+        //while the scan list runs, the register writes may go out with one of its reads
+        if (!m_verifyWrites && scheduler->isRunning()) {
+            for (int i = requests.size() - 1; i >= 0; --i) {
+                const ModbusRequest &request = requests.at(i);
+                if (!EUtils::ModbusIsWriteRegistersFunction(request.functionCode))
+                    continue;
+                for (int j = 0; j < request.values.size(); ++j)
+                    m_committedWrites.add(request.slave, request.functionCode, request.startAddr + j, request.values.at(j));
+                requests.removeAt(i);
+            }
+            if (m_committedWrites.count() > 0 && !m_pairTimer->isActive())
+                m_pairTimer->start(PairWindow);
+        }
+        m_transactionIsPending = !requests.isEmpty();
+        m_pendingRequests = requests.size();
+        for (int i = 0; i < requests.size(); ++i)
+            m_worker->enqueue(requests.at(i));
+        return;
+    }
 
-    modbus_set_slave(m_modbus, slave);
-    //request data from modbus
-    switch(functionCode)
+    ModbusRequest request;
+    request.origin = ModbusRequest::Poll;
+    request.slave = slave;
+    request.functionCode = functionCode;
+    request.startAddr = startAddress;
+    if (functionCode == MODBUS_FC_WRITE_SINGLE_COIL ||
+        functionCode == MODBUS_FC_WRITE_SINGLE_REGISTER)
+        noOfItems = 1;
+    request.noOfItems = noOfItems;
+    //values are taken from the registers model on the GUI thread
+    request.values.resize(noOfItems);
+    for(int i = 0; i < noOfItems; ++i)
     {
-            case MODBUS_FC_WRITE_SINGLE_COIL:
-                    ret = modbus_write_bit(m_modbus, startAddress,regModel->value(0));
-                    noOfItems = 1;
-                    break;
+            request.values[i] = regModel->value(i);
+    }
+    request.verify = m_verifyWrites;
 
-            case MODBUS_FC_WRITE_SINGLE_REGISTER:
-                    ret = modbus_write_register( m_modbus, startAddress,regModel->value(0));
-                    noOfItems = 1;
-                    break;
+    m_transactionIsPending = true;
+    m_pendingRequests = 1;
+    m_worker->enqueue(request);
 
-            case MODBUS_FC_WRITE_MULTIPLE_COILS:
-            {
-                    uint8_t * data = new uint8_t[noOfItems];
-                    for(int i = 0; i < noOfItems; ++i)
-                    {
-                            data[i] = regModel->value(i);
-                    }
-                    ret = modbus_write_bits(m_modbus, startAddress, noOfItems, data);
-                    delete[] data;
-                    break;
-            }
-            case MODBUS_FC_WRITE_MULTIPLE_REGISTERS:
-            {
-                    uint16_t * data = new uint16_t[noOfItems];
-                    for(int i = 0; i < noOfItems; ++i)
-                    {
-                            data[i] = regModel->value(i);
-                    }
-                    ret = modbus_write_registers(m_modbus, startAddress, noOfItems, data);
-                    delete[] data;
-                    break;
-            }
+}
 
-            default:
-                    break;
-    }
+void ModbusAdapter::writeDataDone(const ModbusResult &result)
+{
+
+    int ret = result.ret;
 
-    QLOG_TRACE() <<  "Modbus Write Data return value = " << ret << ", errno = " << errno;;
+    //read back differs from the values written - the device limits or rounds them
+    if (ret == result.request.noOfItems && result.request.verify) {
+        QString line;
+        if (result.data.size() != ret)
+            line = QString("Read back failed. Error : ") + EUtils::libmodbus_strerror(result.error);
+        for (int i = 0; i < result.data.size() && line.isEmpty(); ++i) {
+            if (result.data.at(i) != result.request.values.at(i))
+                line = QString("Read back differs at address %1 : written %2, read %3")
+                       .arg(result.request.startAddr + i).arg(result.request.values.at(i)).arg(result.data.at(i));
+        }
+        if (!line.isEmpty()) {
+            m_errors += 1;
+            QLOG_ERROR() <<  "Write Data verify failed. " << line;
+            rawModel->addLine(EUtils::SysTimeStamp() + " - " + line);
+            emit(errorMessage(tr("Write data verify failed.\n") + line));
+            return;
+        }
+    }
 
     //update data model
-    if(ret == noOfItems)
+    if(ret == result.request.noOfItems)
     {
         //values written correctly
         rawModel->addLine(EUtils::SysTimeStamp() + " - values written correctly.");
-        mainWin->hideInfoBar();
+        emit(errorCleared());
     }
     else
     {
 
+        //written with the next write
+        m_writeQueue.add(result.request);
         regModel->setNoValidValues();
         m_errors += 1;
 
         QString line;
         if(ret < 0) {
-                line = QString("Error : ") +  EUtils::libmodbus_strerror(errno);
+                line = QString("Error : ") +  EUtils::libmodbus_strerror(result.error);
                 QLOG_ERROR() <<  "Write Data failed. " << line;
                 rawModel->addLine(EUtils::SysTimeStamp() + " - " + line);
-                line = QString(tr("Write data failed.\nError : ")) +  EUtils::libmodbus_strerror(errno);
+                line = QString(tr("Write data failed.\nError : ")) +  EUtils::libmodbus_strerror(result.error);
         }
         else {
-                line = QString("Number of registers returned does not match number of registers requested!. Error : ")  +  EUtils::libmodbus_strerror(errno);
+                line = QString("Number of registers returned does not match number of registers requested!. Error : ")  +  EUtils::libmodbus_strerror(result.error);
                 QLOG_ERROR() <<  "Write Data failed. " << line;
                 rawModel->addLine(EUtils::SysTimeStamp() + " - " + line);
-                line = QString(tr("Write data failed.\nNumber of registers returned does not match number of registers requested!. Error : "))  +  EUtils::libmodbus_strerror(errno);
+                line = QString(tr("Write data failed.\nNumber of registers returned does not match number of registers requested!. Error : "))  +  EUtils::libmodbus_strerror(result.error);
          }
 
-        mainWin->showUpInfoBar(line, InfoBar::Error);
-        modbus_flush(m_modbus); //flush data
+        emit(errorMessage(line));
      }
 
 }
 
-void ModbusAdapter::busMonitorRequestData(uint8_t * data, int dataLen)
+void ModbusAdapter::writeReadDone(const ModbusResult &result)
 {
 
-    //Request Raw data from port - Update raw data model
+    //Write part of a scan list FC 0x17 - the values come from a write
+    //transaction of the main window : its outcome is shown like one, the
+    //error is counted once with the scan list error of the same request
 
-    QString line;
+    if (result.split && !m_noWriteRead.contains(result.request.slave)) {
+        QLOG_INFO() <<  "Slave " << result.request.slave << " does not support FC 0x17. Separate write and read";
+        m_noWriteRead.insert(result.request.slave);
+    }
 
-    for(int i = 0; i < dataLen; ++i ) {
-        line += QString().sprintf( "%.2x  ", data[i] );
+    const int noOfItems = result.request.values.size();
+    if (result.written == noOfItems) {
+        rawModel->addLine(EUtils::SysTimeStamp() + " - " +
+                          QString("%1 registers at %2 written correctly with the scan list read.")
+                          .arg(noOfItems).arg(result.request.writeAddr));
+        emit(errorCleared());
+        return;
     }
 
-    QLOG_INFO() << "Tx Data : " << line;
-    line = EUtils::TxTimeStamp(m_ModBusMode) + " - " + line.toUpper();
+    //back with the edits : sent again by the next write, never by the scan list alone
+    ModbusRequest write = result.request;
+    write.functionCode = MODBUS_FC_WRITE_MULTIPLE_REGISTERS;
+    write.startAddr = result.request.writeAddr;
+    write.noOfItems = noOfItems;
+    m_writeQueue.add(write);
+    //the table shows the values not written
+    if (result.request.slave == m_slave && EUtils::ModbusIsWriteRegistersFunction(m_functionCode))
+        regModel->setNoValidValues();
+    //a failed read is already counted by the scan list
+    if (result.ret == result.request.noOfItems)
+        m_errors += 1;
 
-    rawModel->addLine(line);
+    QString line = QString("Error : ") + EUtils::libmodbus_strerror(result.error);
+    QLOG_ERROR() <<  "Write Data with the scan list read failed. " << line;
+    rawModel->addLine(EUtils::SysTimeStamp() + " - " + line);
+    emit(errorMessage(QString(tr("Write data failed.\nError : ")) + EUtils::libmodbus_strerror(result.error)));
+
+}
 
+void ModbusAdapter::sendCommittedWrites()
+{
+
+    //no scan list read of their slave within PairWindow : plain writes
+
+    if (!m_connected || m_committedWrites.count() == 0)
+        return;
+
+    QList<ModbusRequest> requests = m_committedWrites.take(false);
     m_transactionIsPending = true;
+    m_pendingRequests += requests.size();
+    for (int i = 0; i < requests.size(); ++i)
+        m_worker->enqueue(requests.at(i));
 
 }
-void ModbusAdapter::busMonitorResponseData(uint8_t * data, int dataLen)
+
+void ModbusAdapter::reportSlaveId(int slave)
 {
 
-    //Response Raw data from port - Update raw data model
+    QLOG_INFO() <<  "Modbus Report Slave ID ";
 
-    QString line;
+    ModbusRequest request;
+    request.origin = ModbusRequest::Diagnostics;
+    request.slave = slave;
+    request.functionCode = MODBUS_FC_REPORT_SLAVE_ID;
+
+    m_worker->enqueue(request);
+
+}
 
-    for(int i = 0; i < dataLen; ++i ) {
-        line += QString().sprintf( "%.2x  ", data[i] );
+void ModbusAdapter::submit(const ModbusRequest &request)
+{
+
+    //Request from the scan list or the tools - the result comes back with transactionDone
+
+    if (request.device > 0)
+        m_pool->enqueue(request);
+    else
+        m_worker->enqueue(request);
+
+}
+
+bool ModbusAdapter::pairWrite(ModbusRequest &request)
+{
+
+    //Turn a holding register read of the scan list into FC 0x17 with the
+    //registers of the same slave written by the last write transaction :
+    //the setpoints go out with the status read. Edits not written yet are
+    //never sent. Verified writes keep FC 0x10 and their read back
+
+    if (!m_connected || m_verifyWrites || request.device != 0 ||
+        request.functionCode != MODBUS_FC_READ_HOLDING_REGISTERS ||
+        request.noOfItems < 1 || request.noOfItems > MODBUS_MAX_WR_READ_REGISTERS ||
+        m_noWriteRead.contains(request.slave))
+        return false;
+
+    ModbusRequest write;
+    if (!m_committedWrites.takeRegisters(request.slave, MODBUS_MAX_WR_WRITE_REGISTERS, write))
+        return false;
+    if (m_committedWrites.count() == 0)
+        m_pairTimer->stop();
+
+    QLOG_TRACE() <<  "Write " << write.noOfItems << " registers at " << write.startAddr << " with FC 0x17";
+
+    request.functionCode = MODBUS_FC_WRITE_AND_READ_REGISTERS;
+    request.writeAddr = write.startAddr;
+    request.values = write.values;
+    return true;
+
+}
+
+int ModbusAdapter::device(const QString &ip, int port)
+{
+
+    //Connection pool device of ip:port, 0 for the adapter connection
+
+    if (ip.isEmpty())
+        return 0;
+    QString strippedIP = stripIP(ip);
+    return m_pool->device(strippedIP.isEmpty() ? ip : strippedIP, port);
+
+}
+
+void ModbusAdapter::releaseDevice(int device)
+{
+    if (device > 0)
+        m_pool->release(device);
+}
+
+QString ModbusAdapter::deviceName(int device)
+{
+    if (device == 0)
+        return tr("Current connection");
+    return m_pool->deviceName(device);
+}
+
+void ModbusAdapter::resultsReady(QList<ModbusResult> results)
+{
+
+    //Results from the I/O worker - runs on the GUI thread
+
+    for (int i = 0; i < results.size(); ++i) {
+        const ModbusResult &result = results.at(i);
+
+        const int mode = result.request.device > 0 ? (int)EUtils::TCP : m_ModBusMode;
+        for (int j = 0; j < result.frames.size(); ++j)
+            busMonitorData(result.frames.at(j), mode);
+
+        if (result.request.origin == ModbusRequest::Scan) {
+            m_packets += 1;
+            if (result.ret != result.request.noOfItems)
+                m_errors += 1;
+        }
+
+        if (result.request.functionCode == MODBUS_FC_WRITE_AND_READ_REGISTERS)
+            writeReadDone(result);
+
+        if (result.request.origin != ModbusRequest::Poll) {
+            emit(transactionDone(result));
+            continue;
+        }
+
+        m_pendingRequests = qMax(0, m_pendingRequests - 1);
+        m_transactionIsPending = (m_pendingRequests > 0);
+        if (EUtils::ModbusIsWriteFunction(result.request.functionCode))
+            writeDataDone(result);
+        else
+            readDataDone(result);
     }
 
-    QLOG_INFO() << "Rx Data : " << line;
-    line = EUtils::RxTimeStamp(m_ModBusMode) + " - " + line.toUpper();
+    emit(refreshView());
 
-    rawModel->addLine(line);
+}
 
-    m_transactionIsPending = false;
+void ModbusAdapter::busMonitorData(const ModbusFrame &frame, int mode)
+{
+
+    //Raw data from port - Update raw data model
+    //the frame is kept binary, the text is built when the line is displayed
+    //or when the log level needs it
+
+    if (frame.direction == ModbusFrame::Tx) {
+        QLOG_INFO() << "Tx Data : " << RawDataModel::toHex(frame.data);
+        rawModel->addFrame(RawDataRecord::Tx, mode, frame.time, frame.data);
+    }
+    else {
+        QLOG_INFO() << "Rx Data : " << RawDataModel::toHex(frame.data);
+        rawModel->addFrame(RawDataRecord::Rx, mode, frame.time, frame.data);
+    }
 
 }
 
@@ -436,21 +622,42 @@ void ModbusAdapter::setNumOfRegs(int num)
 
 void ModbusAdapter::addItems()
 {
+    //edits of the previous range no longer apply
+    m_writeQueue.clear();
     regModel->addItems(m_startAddr, m_numOfRegs, EUtils::ModbusIsWriteFunction(m_functionCode));
     //If it is a write function -> read registers
     if (!m_connected)
         return;
     else if (EUtils::ModbusIsWriteCoilsFunction(m_functionCode)){
         modbusReadData(m_slave,EUtils::ReadCoils,m_startAddr,m_numOfRegs);
-        emit(refreshView());
     }
     else if (EUtils::ModbusIsWriteRegistersFunction(m_functionCode)){
         modbusReadData(m_slave,EUtils::ReadHoldRegs,m_startAddr,m_numOfRegs);
-        emit(refreshView());
     }
 
 }
 
+void ModbusAdapter::valueEdited(int idx)
+{
+
+    //queued until the next write transaction - later edits of the same cell replace it
+
+    if (!EUtils::ModbusIsWriteFunction(m_functionCode))
+        return;
+    m_writeQueue.add(m_slave, m_functionCode, m_startAddr + idx, regModel->value(idx));
+
+}
+
+void ModbusAdapter::setVerifyWrites(bool verify)
+{
+    m_verifyWrites = verify;
+}
+
+int ModbusAdapter::pendingWrites()
+{
+    return m_writeQueue.count();
+}
+
 void ModbusAdapter::setScanRate(int scanRate)
 {
     m_scanRate = scanRate;
@@ -487,6 +694,24 @@ void ModbusAdapter::setTimeOut(int timeOut)
 {
 
     m_timeOut = timeOut;
+    m_pool->setTimeOut(timeOut);
+
+}
+
+void ModbusAdapter::setAdaptiveTimeOut(bool adaptive)
+{
+
+    //response timeouts learned for each slave, bounded by the timeout setting
+    QMetaObject::invokeMethod(m_worker, "setAdaptiveTimeOut", Qt::QueuedConnection, Q_ARG(bool, adaptive));
+    m_pool->setAdaptiveTimeOut(adaptive);
+
+}
+
+void ModbusAdapter::setPipelineDepth(int depth)
+{
+
+    //applied on the next TCP connection
+    m_pipelineDepth = qMax(1, depth);
 
 }
 
@@ -511,17 +736,3 @@ QString ModbusAdapter::stripIP(QString ip)
         return "";
 
 }
-
-extern "C" {
-
-void busMonitorRawResponseData(uint8_t * data, int dataLen)
-{
-        m_instance->busMonitorResponseData(data, dataLen);
-}
-
-void busMonitorRawRequestData(uint8_t * data, int dataLen)
-{
-        m_instance->busMonitorRequestData(data, dataLen);
-}
-
-}
@@ -2,9 +2,17 @@
 #define MODBUSADAPTER_H
 
 #include <QObject>
+#include <QThread>
+#include <QSet>
 #include "modbus.h"
 #include "registersmodel.h"
 #include "rawdatamodel.h"
+#include "modbusworker.h"
+#include "modbusscheduler.h"
+#include "modbusconnectionpool.h"
+#include "modbuswritequeue.h"
+#include "modbusstatistics.h"
+#include "historian.h"
 #include <QTimer>
 #include "eutils.h"
 
@@ -14,14 +22,15 @@ class ModbusAdapter : public QObject
 public:
      explicit ModbusAdapter(QObject *parent = 0);
      ~ModbusAdapter();
-     void busMonitorRequestData(uint8_t * data,int dataLen);
-     void busMonitorResponseData(uint8_t * data,int dataLen);
 
      void modbusConnectRTU(QString port, int baud, QChar parity, int dataBits, int stopBits, int RTS, int timeOut=1);
      void modbusConnectTCP(QString ip, int port, int timeOut=1);
      void modbusDisConnect();
      RegistersModel *regModel;
      RawDataModel *rawModel;
+     ModbusScheduler *scheduler;
+     ModbusStatistics *statistics;
+     Historian *historian;
      bool isConnected();
 
      void setSlave(int slave);
@@ -32,16 +41,32 @@ public:
 
      void setScanRate(int scanRate);
      void setTimeOut(int timeOut);
+     void setPipelineDepth(int depth);
+     void setVerifyWrites(bool verify);
+     void setAdaptiveTimeOut(bool adaptive);
+     int pendingWrites();
      void startPollTimer();
      void stopPollTimer();
      int packets();
      int errors();
-     modbus_t * m_modbus;
+     void reportSlaveId(int slave);
+     void submit(const ModbusRequest &request);
+     bool pairWrite(ModbusRequest &request);
+     int device(const QString &ip, int port); //takes a reference, see releaseDevice
+     void releaseDevice(int device);
+     QString deviceName(int device);
 
 private:
      void modbusReadData(int slave, int functionCode, int startAddress, int noOfItems);
      void modbusWriteData(int slave, int functionCode, int startAddress, int noOfItems);
+     void readDataDone(const ModbusResult &result);
+     void writeDataDone(const ModbusResult &result);
+     void writeReadDone(const ModbusResult &result);
+     void busMonitorData(const ModbusFrame &frame, int mode);
      QString stripIP(QString ip);
+     ModbusWorker *m_worker;
+     QThread *m_workerThread;
+     ModbusConnectionPool *m_pool;
      bool m_connected;
      int m_ModBusMode;
      int m_slave;
@@ -53,17 +78,31 @@ private:
      int m_packets;
      int m_errors;
      int m_timeOut;
+     int m_pipelineDepth;
      bool m_transactionIsPending;
-     uint8_t *dest;
-     uint16_t *dest16;
+     int m_pendingRequests; //poll requests of the transaction not done yet
+     ModbusWriteQueue m_writeQueue; //cells edited since the last write
+     ModbusWriteQueue m_committedWrites; //written registers waiting for a scan list read (FC 0x17)
+     QTimer *m_pairTimer;
+     bool m_verifyWrites;
+     QSet<int> m_noWriteRead; //slaves that answered FC 0x17 with illegal function
 
 signals:
     void refreshView();
+    void transactionDone(const ModbusResult &result);
+    //no UI dependency - the main window shows them in the info bar
+    void errorMessage(QString message);
+    void errorCleared();
 
 public slots:
     void modbusTransaction();
     void resetCounters();
 
+private slots:
+    void resultsReady(QList<ModbusResult> results);
+    void valueEdited(int idx);
+    void sendCommittedWrites();
+
 };
 
 #endif // MODBUSADAPTER_H
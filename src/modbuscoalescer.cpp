@@ -0,0 +1,116 @@
+#include "modbuscoalescer.h"
+
+#include <algorithm>
+
+static bool rangeLessThan(const ModbusRange &r1, const ModbusRange &r2)
+{
+    if (r1.slave != r2.slave)
+        return r1.slave < r2.slave;
+    if (r1.functionCode != r2.functionCode)
+        return r1.functionCode < r2.functionCode;
+    return r1.startAddr < r2.startAddr;
+}
+
+ModbusCoalescer::ModbusCoalescer()
+{
+    m_maxGap = 0;
+}
+
+void ModbusCoalescer::setMaxGap(int maxGap)
+{
+    m_maxGap = qMax(0, maxGap);
+}
+
+int ModbusCoalescer::maxGap()
+{
+    return m_maxGap;
+}
+
+int ModbusCoalescer::maxItems(int functionCode)
+{
+
+    //Items that fit in one response PDU
+
+    switch(functionCode)
+    {
+            case MODBUS_FC_READ_COILS:
+            case MODBUS_FC_READ_DISCRETE_INPUTS:
+                    return MODBUS_MAX_READ_BITS;
+
+            case MODBUS_FC_READ_HOLDING_REGISTERS:
+            case MODBUS_FC_READ_INPUT_REGISTERS:
+                    return MODBUS_MAX_READ_REGISTERS;
+
+            default:
+                    return 0; //writes are never merged
+    }
+
+}
+
+QList<ModbusBlock> ModbusCoalescer::coalesce(QList<ModbusRange> ranges) const
+{
+
+    //Greedy merge of the ranges sorted by address : a range joins the current
+    //block if the gap is small enough and the block still fits in one PDU.
+    //For a fixed PDU limit this gives the minimum number of blocks.
+
+    QList<ModbusBlock> blocks;
+
+    std::stable_sort(ranges.begin(), ranges.end(), rangeLessThan);
+
+    for (int i = 0; i < ranges.size(); ++i) {
+        const ModbusRange &range = ranges.at(i);
+        const int limit = maxItems(range.functionCode);
+
+        if (!blocks.isEmpty()) {
+            ModbusBlock &block = blocks.last();
+            const int blockEnd = block.startAddr + block.noOfItems;
+            const int end = qMax(blockEnd, range.startAddr + range.noOfItems);
+            if (limit > 0 &&
+                block.slave == range.slave &&
+                block.functionCode == range.functionCode &&
+                range.startAddr - blockEnd <= m_maxGap &&
+                end - block.startAddr <= limit) {
+                block.noOfItems = end - block.startAddr;
+                block.ranges.append(range);
+                continue;
+            }
+        }
+
+        ModbusBlock block;
+        block.slave = range.slave;
+        block.functionCode = range.functionCode;
+        block.startAddr = range.startAddr;
+        block.noOfItems = range.noOfItems;
+        block.ranges.append(range);
+        blocks.append(block);
+    }
+
+    return blocks;
+
+}
+
+ModbusResult ModbusCoalescer::scatter(const ModbusResult &result, const ModbusRange &range)
+{
+
+    //Result of one range, taken from the result of the block that served it
+
+    ModbusResult rangeResult;
+
+    rangeResult.request = result.request;
+    rangeResult.request.startAddr = range.startAddr;
+    rangeResult.request.noOfItems = range.noOfItems;
+    rangeResult.error = result.error;
+
+    const int offset = range.startAddr - result.request.startAddr;
+    if (result.ret == result.request.noOfItems &&
+        offset >= 0 && offset + range.noOfItems <= result.data.size()) {
+        rangeResult.ret = range.noOfItems;
+        rangeResult.data = result.data.mid(offset, range.noOfItems);
+    }
+    else
+        rangeResult.ret = result.ret < 0 ? result.ret : -1;
+
+    return rangeResult;
+
+}
@@ -0,0 +1,50 @@
+#ifndef MODBUSCOALESCER_H
+#define MODBUSCOALESCER_H
+
+#include <QList>
+#include "modbusworker.h"
+
+//Range of items requested by one consumer
+struct ModbusRange
+{
+    ModbusRange() : id(0), slave(1), functionCode(MODBUS_FC_READ_HOLDING_REGISTERS),
+                    startAddr(0), noOfItems(1) {}
+
+    int id; //consumer id, returned with the scattered result
+    int slave;
+    int functionCode;
+    int startAddr;
+    int noOfItems;
+};
+
+//Merged request and the ranges it serves
+struct ModbusBlock
+{
+    ModbusBlock() : slave(1), functionCode(MODBUS_FC_READ_HOLDING_REGISTERS),
+                    startAddr(0), noOfItems(0) {}
+
+    int slave;
+    int functionCode;
+    int startAddr;
+    int noOfItems;
+    QList<ModbusRange> ranges;
+};
+
+//Merges read ranges of the same slave and function code into the fewest PDUs
+class ModbusCoalescer
+{
+public:
+    ModbusCoalescer();
+
+    void setMaxGap(int maxGap);
+    int maxGap();
+    QList<ModbusBlock> coalesce(QList<ModbusRange> ranges) const;
+    static int maxItems(int functionCode);
+    static ModbusResult scatter(const ModbusResult &result, const ModbusRange &range);
+
+private:
+    int m_maxGap; //max number of unused items read between two ranges
+
+};
+
+#endif // MODBUSCOALESCER_H
@@ -1,5 +1,7 @@
 #include "modbuscommsettings.h"
 #include "QsLog.h"
+#include <QCoreApplication>
+#include <QDir>
 
 ModbusCommSettings::ModbusCommSettings(const QString &fileName, Format format , QObject *parent)
     : QSettings(fileName, format, parent)
@@ -41,6 +43,16 @@ QString  ModbusCommSettings::slaveIP()
     return m_slaveIP;
 }
 
+QString  ModbusCommSettings::pipelineDepth()
+{
+    return m_pipelineDepth;
+}
+
+void ModbusCommSettings::setPipelineDepth(QString pipelineDepth)
+{
+    m_pipelineDepth = pipelineDepth;
+}
+
 QString  ModbusCommSettings::serialDev()
 {
     return m_serialDev;
@@ -148,6 +160,61 @@ QString  ModbusCommSettings::timeOut()
     return m_timeOut;
 }
 
+QString  ModbusCommSettings::maxGap()
+{
+    return m_maxGap;
+}
+
+void ModbusCommSettings::setMaxGap(QString maxGap)
+{
+    m_maxGap = maxGap;
+}
+
+bool ModbusCommSettings::highlightChanges()
+{
+    return m_highlightChanges;
+}
+
+void ModbusCommSettings::setHighlightChanges(bool highlight)
+{
+    m_highlightChanges = highlight;
+}
+
+bool ModbusCommSettings::history()
+{
+    return m_history;
+}
+
+void ModbusCommSettings::setHistory(bool history)
+{
+    m_history = history;
+}
+
+QString ModbusCommSettings::historyPath()
+{
+    return m_historyPath;
+}
+
+bool ModbusCommSettings::verifyWrites()
+{
+    return m_verifyWrites;
+}
+
+void ModbusCommSettings::setVerifyWrites(bool verify)
+{
+    m_verifyWrites = verify;
+}
+
+bool ModbusCommSettings::adaptiveTimeOut()
+{
+    return m_adaptiveTimeOut;
+}
+
+void ModbusCommSettings::setAdaptiveTimeOut(bool adaptive)
+{
+    m_adaptiveTimeOut = adaptive;
+}
+
 void ModbusCommSettings::setTimeOut(QString timeOut)
 {
     m_timeOut = timeOut;
@@ -228,6 +295,16 @@ void ModbusCommSettings::setBase(int base)
     m_base = base;
 }
 
+QList<ScanEntry> ModbusCommSettings::scanList()
+{
+    return m_scanList;
+}
+
+void ModbusCommSettings::setScanList(QList<ScanEntry> scanList)
+{
+    m_scanList = scanList;
+}
+
 void ModbusCommSettings::loadSession(QString fName)
 {
 
@@ -259,6 +336,11 @@ void ModbusCommSettings::load(QSettings *s)
     else
         m_slaveIP = s->value("TCP/SlaveIP").toString();
 
+    if (s->value("TCP/PipelineDepth").toInt() < 1)
+        m_pipelineDepth = "1"; //one request at a time
+    else
+        m_pipelineDepth = s->value("TCP/PipelineDepth").toString();
+
     if (s->value("RTU/SerialDev").isNull())
         #ifdef Q_OS_WIN32
             m_serialDev = "COM";
@@ -331,6 +413,24 @@ void ModbusCommSettings::load(QSettings *s)
     else
         m_timeOut = s->value("Var/TimeOut").toString();
 
+    if (s->value("Var/MaxGap").isNull())
+        m_maxGap = "0"; //merge adjacent ranges only
+    else
+        m_maxGap = s->value("Var/MaxGap").toString();
+
+    m_highlightChanges = s->value("Var/HighlightChanges", false).toBool();
+
+    m_history = s->value("Var/History", false).toBool();
+
+    if (s->value("Var/HistoryPath").toString().isEmpty())
+        m_historyPath = QDir(QCoreApplication::applicationDirPath()).filePath("history");
+    else
+        m_historyPath = s->value("Var/HistoryPath").toString();
+
+    m_verifyWrites = s->value("Var/VerifyWrites", false).toBool();
+
+    m_adaptiveTimeOut = s->value("Var/AdaptiveTimeOut", true).toBool();
+
     if (s->value("Var/LoggingLevel").isNull())
         m_loggingLevel = 3; //warning level
     else
@@ -371,6 +471,22 @@ void ModbusCommSettings::load(QSettings *s)
     else
         m_base = s->value("Session/Base").toInt();
 
+    m_scanList.clear();
+    int size = s->beginReadArray("ScanList");
+    for (int i = 0; i < size; ++i) {
+        s->setArrayIndex(i);
+        ScanEntry entry;
+        entry.ip = s->value("IP").toString();
+        entry.port = s->value("Port", entry.port).toInt();
+        entry.slave = s->value("Slave", entry.slave).toInt();
+        entry.functionCode = s->value("FunctionCode", entry.functionCode).toInt();
+        entry.startAddr = s->value("StartAddr", entry.startAddr).toInt();
+        entry.noOfItems = s->value("NoOfItems", entry.noOfItems).toInt();
+        entry.period = s->value("Period", entry.period).toInt();
+        m_scanList.append(entry);
+    }
+    s->endArray();
+
 }
 
 void ModbusCommSettings::save(QSettings *s)
@@ -378,6 +494,7 @@ void ModbusCommSettings::save(QSettings *s)
 
     s->setValue("TCP/TCPPort",m_TCPPort);
     s->setValue("TCP/SlaveIP",m_slaveIP);
+    s->setValue("TCP/PipelineDepth",m_pipelineDepth);
     s->setValue("RTU/SerialDev",m_serialDev);
     s->setValue("RTU/SerialPort",m_serialPort);
     s->setValue("RTU/SerialPortName",m_serialPortName);
@@ -389,6 +506,12 @@ void ModbusCommSettings::save(QSettings *s)
     s->setValue("Var/MaxNoOfLines",m_maxNoOfLines);
     s->setValue("Var/BaseAddr",m_baseAddr);
     s->setValue("Var/TimeOut",m_timeOut);
+    s->setValue("Var/MaxGap",m_maxGap);
+    s->setValue("Var/HighlightChanges",m_highlightChanges);
+    s->setValue("Var/History",m_history);
+    s->setValue("Var/HistoryPath",m_historyPath);
+    s->setValue("Var/VerifyWrites",m_verifyWrites);
+    s->setValue("Var/AdaptiveTimeOut",m_adaptiveTimeOut);
     s->setValue("Var/LoggingLevel",m_loggingLevel);
     s->setValue("Session/ModBusMode",m_modbusMode);
     s->setValue("Session/SlaveID",m_slaveID);
@@ -397,5 +520,18 @@ void ModbusCommSettings::save(QSettings *s)
     s->setValue("Session/StartAddr",m_startAddr);
     s->setValue("Session/NoOfRegs",m_noOfRegs);
     s->setValue("Session/Base",m_base);
+    s->remove("ScanList");
+    s->beginWriteArray("ScanList", m_scanList.size());
+    for (int i = 0; i < m_scanList.size(); ++i) {
+        s->setArrayIndex(i);
+        s->setValue("IP", m_scanList[i].ip);
+        s->setValue("Port", m_scanList[i].port);
+        s->setValue("Slave", m_scanList[i].slave);
+        s->setValue("FunctionCode", m_scanList[i].functionCode);
+        s->setValue("StartAddr", m_scanList[i].startAddr);
+        s->setValue("NoOfItems", m_scanList[i].noOfItems);
+        s->setValue("Period", m_scanList[i].period);
+    }
+    s->endArray();
 
 }
@@ -2,6 +2,8 @@
 #define MODBUSCOMMSETTINGS_H
 
 #include <QSettings>
+#include <QList>
+#include "modbusscheduler.h"
 
 class ModbusCommSettings : public QSettings
 {
@@ -14,6 +16,8 @@ public:
     void setTCPPort(QString tcpPort);
     void setSlaveIP(QString IP);
     QString slaveIP();
+    QString pipelineDepth();
+    void setPipelineDepth(QString pipelineDepth);
     //Serial
     QString serialDev();
     QString serialPort();
@@ -36,6 +40,17 @@ public:
     void setBaseAddr(QString baseAddr);
     QString  timeOut();
     void setTimeOut(QString timeOut);
+    QString  maxGap();
+    void setMaxGap(QString maxGap);
+    bool highlightChanges();
+    void setHighlightChanges(bool highlight);
+    bool history();
+    void setHistory(bool history);
+    QString historyPath();
+    bool verifyWrites();
+    void setVerifyWrites(bool verify);
+    bool adaptiveTimeOut();
+    void setAdaptiveTimeOut(bool adaptive);
     void loadSettings();
     void saveSettings();
     //logging
@@ -55,6 +70,8 @@ public:
     void setNoOfRegs(int noOfRegs);
     int base();
     void setBase(int base);
+    QList<ScanEntry> scanList();
+    void setScanList(QList<ScanEntry> scanList);
     void loadSession(QString fName);
     void saveSession(QString fName);
 
@@ -62,6 +79,7 @@ private:
     //TCP
     QString m_TCPPort;
     QString m_slaveIP;
+    QString m_pipelineDepth;
     //Serial
     QString m_serialDev;
     QString m_serialPort;
@@ -75,6 +93,12 @@ private:
     QString m_maxNoOfLines;
     QString m_baseAddr;
     QString m_timeOut;
+    QString m_maxGap;
+    bool m_highlightChanges;
+    bool m_history;
+    QString m_historyPath;
+    bool m_verifyWrites;
+    bool m_adaptiveTimeOut;
     void load(QSettings *s);
     void save(QSettings *s);
     //Log
@@ -87,6 +111,7 @@ private:
     int m_startAddr;
     int m_noOfRegs;
     int m_base;
+    QList<ScanEntry> m_scanList;
 
 signals:
 
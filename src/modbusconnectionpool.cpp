@@ -0,0 +1,192 @@
+#include "modbusconnectionpool.h"
+
+#include "QsLog.h"
+
+ModbusConnectionPool::ModbusConnectionPool(QObject *parent) :
+    QObject(parent)
+{
+    m_maxThreads = 32;
+    m_timeOut = 0;
+    m_adaptiveTimeOut = true;
+    m_statistics = NULL;
+}
+
+ModbusConnectionPool::~ModbusConnectionPool()
+{
+    for (int i = 0; i < m_workers.size(); ++i) {
+        if (m_workers.at(i))
+            m_workers.at(i)->clearQueue();
+    }
+    for (int i = 0; i < m_threads.size(); ++i) {
+        m_threads.at(i)->quit();
+        m_threads.at(i)->wait();
+    }
+    qDeleteAll(m_workers);
+}
+
+int ModbusConnectionPool::device(const QString &ip, int port)
+{
+
+    //Device id of ip:port - the worker is created on first use and
+    //connects when its first request is executed
+
+    const QString name = ip + ":" + QString::number(port);
+    if (m_devices.contains(name)) {
+        const int device = m_devices.value(name);
+        m_references[device - 1]++;
+        return device;
+    }
+
+    QLOG_INFO() <<  "Connection pool add device " << name;
+
+    ModbusWorker *worker = new ModbusWorker();
+    worker->setDevice(ip, port, m_timeOut);
+    worker->setAdaptiveTimeOut(m_adaptiveTimeOut);
+    worker->setStatistics(m_statistics);
+    worker->moveToThread(nextThread());
+    connect(worker,SIGNAL(resultsReady(QList<ModbusResult>)),this,SIGNAL(resultsReady(QList<ModbusResult>)));
+
+    //a device opened again gets its previous id : same statistics entries
+    int device = m_names.indexOf(name) + 1;
+    if (device > 0) {
+        m_workers[device - 1] = worker;
+        m_references[device - 1] = 1;
+    }
+    else {
+        m_workers.append(worker);
+        m_names.append(name);
+        m_references.append(1);
+        device = m_workers.size();
+    }
+    m_devices.insert(name, device);
+
+    return device;
+
+}
+
+void ModbusConnectionPool::release(int device)
+{
+
+    //the last reference closes the connection and frees the worker
+
+    if (device < 1 || device > m_workers.size() || m_workers.at(device - 1) == NULL)
+        return;
+    if (--m_references[device - 1] > 0)
+        return;
+
+    QLOG_INFO() <<  "Connection pool remove device " << m_names.at(device - 1);
+
+    ModbusWorker *worker = m_workers.at(device - 1);
+    m_workers[device - 1] = NULL;
+    m_devices.remove(m_names.at(device - 1));
+    //the worker closes its connection when it is deleted on its thread,
+    //after the transaction on the wire - the GUI does not wait for it
+    worker->clearQueue();
+    disconnect(worker, 0, this, 0);
+    worker->deleteLater();
+
+}
+
+QString ModbusConnectionPool::deviceName(int device)
+{
+    return m_names.value(device - 1);
+}
+
+QThread *ModbusConnectionPool::nextThread()
+{
+
+    //a thread per device up to m_maxThreads, then the thread with the fewest devices
+
+    QHash<QThread *, int> load;
+    for (int i = 0; i < m_workers.size(); ++i) {
+        if (m_workers.at(i))
+            load[m_workers.at(i)->thread()]++;
+    }
+
+    QThread *next = NULL;
+    for (int i = 0; i < m_threads.size(); ++i) {
+        if (next == NULL || load.value(m_threads.at(i)) < load.value(next))
+            next = m_threads.at(i);
+    }
+    if (next != NULL && (load.value(next) == 0 || m_threads.size() >= m_maxThreads))
+        return next;
+
+    QThread *thread = new QThread(this);
+    thread->start();
+    m_threads.append(thread);
+    return thread;
+
+}
+
+void ModbusConnectionPool::enqueue(const ModbusRequest &request)
+{
+
+    if (request.device < 1 || request.device > m_workers.size() || m_workers.at(request.device - 1) == NULL)
+        return;
+
+    m_workers.at(request.device - 1)->enqueue(request);
+
+}
+
+void ModbusConnectionPool::setTimeOut(int timeOut)
+{
+
+    //applied when the devices reconnect
+    m_timeOut = timeOut;
+    for (int i = 0; i < m_workers.size(); ++i) {
+        if (m_workers.at(i) == NULL)
+            continue;
+        const QString name = deviceName(i + 1);
+        QMetaObject::invokeMethod(m_workers.at(i), "setDevice", Qt::QueuedConnection,
+                                  Q_ARG(QString, name.section(':', 0, 0)),
+                                  Q_ARG(int, name.section(':', 1, 1).toInt()),
+                                  Q_ARG(int, m_timeOut));
+    }
+
+}
+
+void ModbusConnectionPool::setAdaptiveTimeOut(bool adaptive)
+{
+
+    m_adaptiveTimeOut = adaptive;
+    for (int i = 0; i < m_workers.size(); ++i) {
+        if (m_workers.at(i))
+            QMetaObject::invokeMethod(m_workers.at(i), "setAdaptiveTimeOut", Qt::QueuedConnection,
+                                      Q_ARG(bool, m_adaptiveTimeOut));
+    }
+
+}
+
+void ModbusConnectionPool::setMaxThreads(int maxThreads)
+{
+    m_maxThreads = qMax(1, maxThreads);
+}
+
+void ModbusConnectionPool::setStatistics(ModbusStatistics *statistics)
+{
+    //given to the workers created afterwards
+    m_statistics = statistics;
+}
+
+void ModbusConnectionPool::disconnectAll()
+{
+
+    //drop queued requests and close every device
+
+    QLOG_INFO() <<  "Connection pool disconnect. Devices = " << m_devices.size();
+
+    for (int i = 0; i < m_workers.size(); ++i) {
+        ModbusWorker *worker = m_workers.at(i);
+        if (worker == NULL)
+            continue;
+        worker->clearQueue();
+        //after the transaction on the wire - a new request reconnects
+        QMetaObject::invokeMethod(worker, "disconnectDevice", Qt::QueuedConnection);
+    }
+
+}
+
+int ModbusConnectionPool::count()
+{
+    return m_devices.size();
+}
@@ -0,0 +1,49 @@
+#ifndef MODBUSCONNECTIONPOOL_H
+#define MODBUSCONNECTIONPOOL_H
+
+#include <QObject>
+#include <QThread>
+#include <QList>
+#include <QHash>
+#include <QStringList>
+#include "modbusworker.h"
+
+//TCP devices polled in parallel : one worker (libmodbus context) per device,
+//the workers share a small pool of threads. A device is closed when the
+//last scan entry that uses it releases it, its id is kept for its name.
+class ModbusConnectionPool : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ModbusConnectionPool(QObject *parent = 0);
+    ~ModbusConnectionPool();
+
+    int device(const QString &ip, int port); //takes a reference
+    void release(int device);
+    QString deviceName(int device);
+    void enqueue(const ModbusRequest &request);
+    void setTimeOut(int timeOut);
+    void setAdaptiveTimeOut(bool adaptive);
+    void setMaxThreads(int maxThreads);
+    void setStatistics(ModbusStatistics *statistics);
+    void disconnectAll();
+    int count();
+
+signals:
+    void resultsReady(QList<ModbusResult> results);
+
+private:
+    QThread *nextThread();
+    QList<QThread *> m_threads;
+    QList<ModbusWorker *> m_workers; //device n is m_workers[n - 1], NULL when released
+    QStringList m_names; //ip:port of each device id
+    QList<int> m_references; //scan entries using each device
+    QHash<QString, int> m_devices; //open devices by name
+    int m_maxThreads;
+    int m_timeOut;
+    bool m_adaptiveTimeOut;
+    ModbusStatistics *m_statistics;
+
+};
+
+#endif // MODBUSCONNECTIONPOOL_H
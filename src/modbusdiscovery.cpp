@@ -0,0 +1,473 @@
+#include "modbusdiscovery.h"
+
+#include "QsLog.h"
+#include "eutils.h"
+#include <QHostAddress>
+#include <errno.h>
+
+//Sweeps larger than this are refused - a /16 on four ports
+static const qint64 MaxProbes = 65536 * 4;
+//Period of the TCP timeout check
+static const int TimeoutCheckPeriod = 50; //ms
+//Transaction ID of the TCP probe request
+static const int ProbeTransactionId = 0x5144;
+
+ModbusRtuSweep::ModbusRtuSweep(QObject *parent) :
+    QThread(parent)
+{
+    m_modbus = NULL;
+    m_turnaround = MinTurnaround;
+}
+
+ModbusRtuSweep::~ModbusRtuSweep()
+{
+    stopSweep();
+}
+
+bool ModbusRtuSweep::startSweep(const DiscoveryConfig &config)
+{
+
+    QLOG_INFO()<<  "RTU sweep start. Port = " << config.serialPort << " , slaves " << config.firstSlave << "-" << config.lastSlave;
+
+    stopSweep();
+    m_config = config;
+    m_errorString.clear();
+    m_stop = 0;
+
+    m_modbus = modbus_new_rtu(config.serialPort.toLatin1().constData(), config.baud, config.parity.toLatin1(),
+                              config.dataBits, config.stopBits, config.RTS);
+    if (m_modbus == NULL) {
+        m_errorString = tr("Unable to create the Modbus context.");
+        return false;
+    }
+    if (modbus_connect(m_modbus) == -1) {
+        m_errorString = tr("Unable to open %1 : %2").arg(config.serialPort, EUtils::libmodbus_strerror(errno));
+        modbus_free(m_modbus);
+        m_modbus = NULL;
+        return false;
+    }
+    #ifndef Q_OS_WIN32
+        if (config.RTS != MODBUS_RTU_RTS_NONE) {
+            modbus_rtu_set_rts(m_modbus, config.RTS);
+            modbus_rtu_set_serial_mode(m_modbus, MODBUS_RTU_RS485);
+        }
+    #endif
+    modbus_set_error_recovery(m_modbus, MODBUS_ERROR_RECOVERY_PROTOCOL);
+
+    start();
+    return true;
+
+}
+
+void ModbusRtuSweep::stopSweep()
+{
+
+    if (isRunning()) {
+        QLOG_INFO()<<  "RTU sweep stop";
+        m_stop = 1;
+        wait();
+    }
+    if (m_modbus != NULL) {
+        modbus_close(m_modbus);
+        modbus_free(m_modbus);
+        m_modbus = NULL;
+    }
+
+}
+
+QString ModbusRtuSweep::errorString()
+{
+    return m_errorString;
+}
+
+int ModbusRtuSweep::frameTime()
+{
+
+    //read holding register request (8 bytes), reply (7 bytes) and the
+    //3.5 characters silences
+
+    const int bits = 1 + m_config.dataBits + (m_config.parity.toUpper() == 'N' ? 0 : 1) + m_config.stopBits;
+    return (22 * bits * 1000) / qMax(m_config.baud, 1) + 1;
+
+}
+
+void ModbusRtuSweep::setTimeOut(int timeOut)
+{
+    modbus_set_response_timeout(m_modbus, timeOut / 1000, (timeOut % 1000) * 1000);
+}
+
+bool ModbusRtuSweep::probe(int slave, int timeOut, DiscoveryResult &result)
+{
+
+    //Read holding register 0 - any reply, exceptions included, is a slave
+
+    setTimeOut(timeOut);
+    modbus_set_slave(m_modbus, slave);
+    uint16_t value = 0;
+    QElapsedTimer timer;
+    timer.start();
+    const int ret = modbus_read_registers(m_modbus, 0, 1, &value);
+    const int error = errno;
+
+    result.address = m_config.serialPort;
+    result.slave = slave;
+    result.responseTime = (int)timer.elapsed();
+
+    if (ret == 1) {
+        result.modbus = true;
+        result.info = tr("Register 0 = %1").arg(value);
+    }
+    else if (error > MODBUS_ENOBASE && error < EMBXGPATH) {
+        result.modbus = true;
+        result.info = EUtils::libmodbus_strerror(error);
+    }
+    else if (error == EMBBADCRC || error == EMBBADDATA || error == EMBBADSLAVE || error == EMBMDATA) {
+        //a late reply of the previous slave or a wrong line setting
+        modbus_flush(m_modbus);
+        result.modbus = false;
+        result.info = tr("Garbled reply : %1").arg(EUtils::libmodbus_strerror(error));
+        return true;
+    }
+    else {
+        modbus_flush(m_modbus);
+        return false;
+    }
+
+    //the next timeouts cover this slave
+    m_turnaround = qMax(m_turnaround, result.responseTime - frameTime());
+
+    //slave ID of the devices that support it - the reply length is unknown
+    uint8_t id[MODBUS_MAX_PDU_LENGTH];
+    setTimeOut(m_config.timeOut);
+    const int n = modbus_report_slave_id(m_modbus, sizeof(id), id);
+    if (n > 2)
+        result.info = tr("ID : %1").arg(QString::fromLatin1((const char *)id + 2, n - 2).simplified()) + " , " + result.info;
+    else
+        modbus_flush(m_modbus);
+
+    return true;
+
+}
+
+void ModbusRtuSweep::run()
+{
+
+    //First pass with the adaptive timeout, the second one retries the
+    //silent slaves with the configured timeout
+
+    const int count = m_config.lastSlave - m_config.firstSlave + 1;
+    int total = m_config.retrySilent ? 2 * count : count;
+    int done = 0;
+    QList<int> silent;
+    m_turnaround = MinTurnaround;
+
+    for (int slave = m_config.firstSlave; slave <= m_config.lastSlave && !m_stop.loadAcquire(); ++slave) {
+        DiscoveryResult result;
+        if (probe(slave, qMin(m_config.timeOut, frameTime() + 3 * m_turnaround), result))
+            emit(found(result));
+        else
+            silent.append(slave);
+        emit(progress(++done, total));
+    }
+
+    if (m_config.retrySilent) {
+        total = count + silent.size();
+        for (int i = 0; i < silent.size() && !m_stop.loadAcquire(); ++i) {
+            DiscoveryResult result;
+            if (probe(silent.at(i), m_config.timeOut, result))
+                emit(found(result));
+            emit(progress(++done, total));
+        }
+    }
+
+    //release the port for the connection
+    modbus_close(m_modbus);
+    modbus_free(m_modbus);
+    m_modbus = NULL;
+
+    QLOG_INFO()<<  "RTU sweep done. Slow turnaround = " << m_turnaround << " ms";
+
+}
+
+ModbusDiscovery::ModbusDiscovery(QObject *parent) :
+    QObject(parent)
+{
+
+    qRegisterMetaType<DiscoveryResult>("DiscoveryResult");
+
+    m_rtuSweep = new ModbusRtuSweep(this);
+    m_timeoutTimer = new QTimer(this);
+    m_next = 0;
+    m_total = 0;
+    m_done = 0;
+    m_running = false;
+    m_launching = false;
+
+    connect(m_rtuSweep,SIGNAL(found(DiscoveryResult)),this,SIGNAL(found(DiscoveryResult)));
+    connect(m_rtuSweep,SIGNAL(progress(int,int)),this,SIGNAL(progress(int,int)));
+    connect(m_rtuSweep,SIGNAL(finished()),this,SLOT(rtuFinished()));
+    connect(m_timeoutTimer,SIGNAL(timeout()),this,SLOT(checkTimeouts()));
+
+}
+
+ModbusDiscovery::~ModbusDiscovery()
+{
+    stop();
+}
+
+bool ModbusDiscovery::start(const DiscoveryConfig &config)
+{
+
+    stop();
+    m_config = config;
+    m_config.timeOut = qMax(config.timeOut, 10);
+    m_config.connections = qBound(1, config.connections, 1000);
+    m_errorString.clear();
+
+    if (config.mode == DiscoveryConfig::RTU) {
+        if (config.lastSlave < config.firstSlave) {
+            m_errorString = tr("No slave address to scan.");
+            return false;
+        }
+        if (!m_rtuSweep->startSweep(m_config)) {
+            m_errorString = m_rtuSweep->errorString();
+            return false;
+        }
+        m_running = true;
+        return true;
+    }
+
+    if (config.ports.isEmpty() || config.lastIP < config.firstIP) {
+        m_errorString = tr("No address or port to scan.");
+        return false;
+    }
+    m_total = ((qint64)config.lastIP - config.firstIP + 1) * config.ports.size();
+    if (m_total > MaxProbes) {
+        m_errorString = tr("Too many addresses : %1 probes, %2 max.").arg(m_total).arg(MaxProbes);
+        return false;
+    }
+
+    QLOG_INFO()<<  "TCP sweep start. " << m_total << " probes, " << m_config.connections << " in flight";
+
+    m_next = 0;
+    m_done = 0;
+    m_running = true;
+    emit(progress(0, (int)m_total));
+    m_timeoutTimer->start(TimeoutCheckPeriod);
+    launchProbes();
+    return true;
+
+}
+
+void ModbusDiscovery::stop()
+{
+
+    m_rtuSweep->stopSweep();
+
+    QList<QTcpSocket *> sockets = m_probes.keys();
+    for (int i = 0; i < sockets.size(); ++i) {
+        sockets.at(i)->disconnect(this);
+        sockets.at(i)->abort();
+        sockets.at(i)->deleteLater();
+    }
+    m_probes.clear();
+    m_timeoutTimer->stop();
+    m_next = m_total;
+
+    if (m_running) {
+        m_running = false;
+        emit(finished());
+    }
+
+}
+
+bool ModbusDiscovery::isRunning()
+{
+    return m_running;
+}
+
+QString ModbusDiscovery::errorString()
+{
+    return m_errorString;
+}
+
+void ModbusDiscovery::launchProbes()
+{
+
+    //keep the configured number of connects in flight
+    //connectToHost reports immediate failures (unreachable network...)
+    //synchronously : the probe is finished from inside this loop, which
+    //refills its place instead of recursing once per address
+
+    if (m_launching)
+        return;
+    m_launching = true;
+
+    while (m_running && m_probes.size() < m_config.connections && m_next < m_total) {
+        const int ports = m_config.ports.size();
+        Probe probe;
+        probe.ip = m_config.firstIP + (quint32)(m_next / ports);
+        probe.port = m_config.ports.at((int)(m_next % ports));
+        probe.state = Connecting;
+        probe.timer.start();
+        m_next++;
+
+        QTcpSocket *socket = new QTcpSocket(this);
+        connect(socket,SIGNAL(connected()),this,SLOT(probeConnected()));
+        connect(socket,SIGNAL(readyRead()),this,SLOT(probeReadyRead()));
+        connect(socket,SIGNAL(error(QAbstractSocket::SocketError)),this,SLOT(probeError(QAbstractSocket::SocketError)));
+        m_probes.insert(socket, probe);
+        socket->connectToHost(QHostAddress(probe.ip), probe.port);
+    }
+
+    m_launching = false;
+
+    if (m_running && m_probes.isEmpty() && m_next >= m_total) {
+        QLOG_INFO()<<  "TCP sweep done";
+        m_running = false;
+        m_timeoutTimer->stop();
+        emit(finished());
+    }
+
+}
+
+void ModbusDiscovery::finishProbe(QTcpSocket *socket)
+{
+
+    if (!m_probes.contains(socket))
+        return;
+    m_probes.remove(socket);
+    socket->disconnect(this);
+    socket->abort();
+    socket->deleteLater();
+    m_done++;
+    emit(progress((int)m_done, (int)m_total));
+
+}
+
+void ModbusDiscovery::reportProbe(QTcpSocket *socket, const Probe &probe)
+{
+
+    //port open : Modbus if the reply has our transaction and function code
+    //the exceptions (gateway without target...) are Modbus replies too
+
+    DiscoveryResult result;
+    result.address = QHostAddress(probe.ip).toString();
+    result.port = probe.port;
+    result.slave = m_config.unitId;
+    result.responseTime = (int)probe.timer.elapsed();
+
+    const QByteArray &reply = probe.reply;
+    if (reply.size() < 9) {
+        result.info = socket->state() == QAbstractSocket::ConnectedState ?
+                      tr("Port open, no Modbus reply") : tr("Port open, closed by the device");
+    }
+    else {
+        const int tid = ((quint8)reply.at(0) << 8) | (quint8)reply.at(1);
+        const int pid = ((quint8)reply.at(2) << 8) | (quint8)reply.at(3);
+        const int functionCode = (quint8)reply.at(7);
+        result.modbus = tid == ProbeTransactionId && pid == 0 && (functionCode & 0x7f) == MODBUS_FC_READ_HOLDING_REGISTERS;
+        if (!result.modbus)
+            result.info = tr("Port open, not a Modbus reply");
+        else if (functionCode & 0x80)
+            result.info = EUtils::libmodbus_strerror(MODBUS_ENOBASE + (quint8)reply.at(8));
+        else if (reply.size() >= 11)
+            result.info = tr("Register 0 = %1").arg(((quint8)reply.at(9) << 8) | (quint8)reply.at(10));
+    }
+
+    emit(found(result));
+
+}
+
+void ModbusDiscovery::probeConnected()
+{
+
+    //Port open - read holding register 0 of the unit
+
+    QTcpSocket *socket = qobject_cast<QTcpSocket *>(sender());
+    if (socket == NULL || !m_probes.contains(socket))
+        return;
+
+    Probe &probe = m_probes[socket];
+    probe.state = Probing;
+    probe.timer.restart();
+
+    const char request[] = {(char)(ProbeTransactionId >> 8), (char)(ProbeTransactionId & 0xff),
+                            0x00, 0x00, 0x00, 0x06, (char)m_config.unitId,
+                            MODBUS_FC_READ_HOLDING_REGISTERS, 0x00, 0x00, 0x00, 0x01};
+    socket->write(request, sizeof(request));
+
+}
+
+void ModbusDiscovery::probeReadyRead()
+{
+
+    QTcpSocket *socket = qobject_cast<QTcpSocket *>(sender());
+    if (socket == NULL || !m_probes.contains(socket))
+        return;
+
+    Probe &probe = m_probes[socket];
+    probe.reply.append(socket->readAll());
+
+    //MBAP header, function code, then the byte count or the exception code
+    if (probe.reply.size() < 9)
+        return;
+    if ((quint8)probe.reply.at(7) == MODBUS_FC_READ_HOLDING_REGISTERS && probe.reply.size() < 11)
+        return;
+
+    reportProbe(socket, probe);
+    finishProbe(socket);
+    launchProbes();
+
+}
+
+void ModbusDiscovery::probeError(QAbstractSocket::SocketError error)
+{
+
+    //refused, unreachable... : nothing there, unless the device closed
+    //the connection after our request
+
+    QTcpSocket *socket = qobject_cast<QTcpSocket *>(sender());
+    if (socket == NULL || !m_probes.contains(socket))
+        return;
+
+    const Probe probe = m_probes.value(socket);
+    if (probe.state == Probing && error == QAbstractSocket::RemoteHostClosedError)
+        reportProbe(socket, probe);
+    finishProbe(socket);
+    launchProbes();
+
+}
+
+void ModbusDiscovery::checkTimeouts()
+{
+
+    QList<QTcpSocket *> expired;
+    for (QHash<QTcpSocket *, Probe>::const_iterator it = m_probes.constBegin(); it != m_probes.constEnd(); ++it) {
+        if (it.value().timer.elapsed() > m_config.timeOut)
+            expired.append(it.key());
+    }
+
+    for (int i = 0; i < expired.size(); ++i) {
+        QTcpSocket *socket = expired.at(i);
+        //no connection : filtered or no host, no reply : not Modbus or wrong unit
+        if (m_probes.value(socket).state == Probing)
+            reportProbe(socket, m_probes.value(socket));
+        finishProbe(socket);
+    }
+
+    if (!expired.isEmpty())
+        launchProbes();
+
+}
+
+void ModbusDiscovery::rtuFinished()
+{
+
+    //a stopped sweep already reported its end
+    if (m_running && m_config.mode == DiscoveryConfig::RTU && !m_rtuSweep->isRunning()) {
+        m_running = false;
+        emit(finished());
+    }
+
+}
@@ -0,0 +1,147 @@
+#ifndef MODBUSDISCOVERY_H
+#define MODBUSDISCOVERY_H
+
+#include <QObject>
+#include <QThread>
+#include <QTimer>
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QTcpSocket>
+#include "modbus.h"
+
+//One device found by the discovery
+struct DiscoveryResult
+{
+    DiscoveryResult() : port(0), slave(0), responseTime(0), modbus(false) {}
+
+    QString address; //serial port or IP
+    int port; //TCP port, 0 for RTU
+    int slave;
+    int responseTime; //ms
+    bool modbus; //a valid Modbus reply - else port open or garbled reply only
+    QString info; //slave ID, register 0 or exception
+};
+Q_DECLARE_METATYPE(DiscoveryResult)
+
+//Discovery settings
+struct DiscoveryConfig
+{
+    enum Mode {RTU = 0, TCP = 1};
+
+    DiscoveryConfig() : mode(RTU), baud(9600), parity('N'), dataBits(8), stopBits(1), RTS(0),
+                        firstSlave(1), lastSlave(247), retrySilent(false),
+                        firstIP(0), lastIP(0), unitId(1), connections(256), timeOut(1000) {}
+
+    int mode;
+    //RTU : the serial port settings and the slave range
+    QString serialPort;
+    int baud;
+    QChar parity;
+    int dataBits;
+    int stopBits;
+    int RTS;
+    int firstSlave;
+    int lastSlave;
+    bool retrySilent; //second pass with timeOut for the slaves silent in the first
+    //TCP : every port of every address in the range
+    quint32 firstIP;
+    quint32 lastIP;
+    QList<int> ports;
+    int unitId;
+    int connections; //connects in flight
+    int timeOut; //ms - RTU : bound of the adaptive timeout, TCP : connect and reply
+};
+
+//Slave ID sweep of a serial bus - blocking libmodbus calls on its own thread
+//The timeout follows the slowest slave found so far : the silent addresses,
+//most of the bus, cost little more than the frames
+class ModbusRtuSweep : public QThread
+{
+    Q_OBJECT
+public:
+    explicit ModbusRtuSweep(QObject *parent = 0);
+    ~ModbusRtuSweep();
+
+    enum {MinTurnaround = 30}; //ms, device answer time assumed before any reply
+
+    bool startSweep(const DiscoveryConfig &config);
+    void stopSweep();
+    QString errorString();
+
+protected:
+    void run();
+
+private:
+    bool probe(int slave, int timeOut, DiscoveryResult &result);
+    void setTimeOut(int timeOut);
+    int frameTime(); //ms, request and reply on the wire
+    DiscoveryConfig m_config;
+    modbus_t *m_modbus;
+    QString m_errorString;
+    QAtomicInt m_stop;
+    int m_turnaround; //ms, slowest answer seen
+
+signals:
+    void found(const DiscoveryResult &result);
+    void progress(int done, int total);
+
+};
+
+//Device discovery : slave ID sweep on RTU, address and port sweep on TCP
+//TCP probes are non-blocking sockets on the caller thread, the connects of
+//hundreds of addresses overlap. An open port gets a read holding register
+//request to tell Modbus devices from other services.
+class ModbusDiscovery : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ModbusDiscovery(QObject *parent = 0);
+    ~ModbusDiscovery();
+
+    bool start(const DiscoveryConfig &config);
+    void stop();
+    bool isRunning();
+    QString errorString();
+
+private:
+    enum ProbeState {Connecting = 0, Probing};
+    struct Probe
+    {
+        quint32 ip;
+        int port;
+        int state;
+        QElapsedTimer timer;
+        QByteArray reply;
+    };
+    void launchProbes();
+    void finishProbe(QTcpSocket *socket);
+    void reportProbe(QTcpSocket *socket, const Probe &probe);
+    DiscoveryConfig m_config;
+    ModbusRtuSweep *m_rtuSweep;
+    QHash<QTcpSocket *, Probe> m_probes; //in flight
+    QTimer *m_timeoutTimer;
+    qint64 m_next; //next probe of the sweep
+    qint64 m_total;
+    qint64 m_done;
+    bool m_running;
+    bool m_launching; //launchProbes is on the stack
+    QString m_errorString;
+
+signals:
+    void found(const DiscoveryResult &result);
+    void progress(int done, int total);
+    void finished();
+
+private slots:
+    void probeConnected();
+    void probeReadyRead();
+    void probeError(QAbstractSocket::SocketError error);
+    void checkTimeouts();
+    void rtuFinished();
+
+};
+
+#endif // MODBUSDISCOVERY_H
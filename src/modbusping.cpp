@@ -0,0 +1,224 @@
+#include "modbusping.h"
+
+#include "QsLog.h"
+#include "eutils.h"
+#include "modbus.h"
+#include <math.h>
+
+ModbusPing::ModbusPing(QObject *parent) :
+    QObject(parent)
+{
+
+    m_socket = new QTcpSocket(this);
+    m_timeoutTimer = new QTimer(this);
+    m_timeoutTimer->setSingleShot(true);
+    m_intervalTimer = new QTimer(this);
+    m_intervalTimer->setSingleShot(true);
+    m_port = 502;
+    m_unitId = 1;
+    m_count = 0;
+    m_timeOut = 1000;
+    m_modbus = true;
+    m_state = Idle;
+
+    connect(m_socket,SIGNAL(connected()),this,SLOT(connected()));
+    connect(m_socket,SIGNAL(readyRead()),this,SLOT(readyRead()));
+    connect(m_socket,SIGNAL(error(QAbstractSocket::SocketError)),this,SLOT(socketError(QAbstractSocket::SocketError)));
+    connect(m_timeoutTimer,SIGNAL(timeout()),this,SLOT(timeout()));
+    connect(m_intervalTimer,SIGNAL(timeout()),this,SLOT(nextRound()));
+
+}
+
+ModbusPing::~ModbusPing()
+{
+    stop();
+}
+
+void ModbusPing::start(const QString &ip, int port, int unitId, int count, int interval, int timeOut, bool modbus)
+{
+
+    QLOG_INFO()<<  "Modbus ping " << ip << ":" << port << " , unit " << unitId << " , " << count << " rounds";
+
+    stop();
+    m_ip = ip;
+    m_port = port;
+    m_unitId = unitId;
+    m_count = qMax(count, 1);
+    m_timeOut = qMax(timeOut, 10);
+    m_modbus = modbus;
+    m_intervalTimer->setInterval(qMax(interval, 0));
+    m_connectTimes.clear();
+    m_modbusTimes.clear();
+    m_round = PingRound();
+
+    nextRound();
+
+}
+
+void ModbusPing::stop()
+{
+
+    m_timeoutTimer->stop();
+    m_intervalTimer->stop();
+    m_socket->abort();
+    m_state = Idle;
+    m_count = 0;
+
+}
+
+bool ModbusPing::isRunning()
+{
+    return m_state != Idle || m_intervalTimer->isActive();
+}
+
+void ModbusPing::nextRound()
+{
+
+    m_round = PingRound();
+    m_round.seq = m_connectTimes.size() + 1;
+    m_reply.clear();
+    m_state = Connecting;
+    m_timer.start();
+    m_timeoutTimer->start(m_timeOut);
+    m_socket->abort();
+    m_socket->connectToHost(m_ip, m_port);
+
+}
+
+void ModbusPing::connected()
+{
+
+    if (m_state != Connecting)
+        return;
+
+    m_round.connectTime = m_timer.nsecsElapsed() / 1000000.0;
+    if (!m_modbus) {
+        finishRound(tr("Port open"));
+        return;
+    }
+
+    //read holding register 0, the sequence number is the transaction ID
+    m_state = Waiting;
+    m_timer.restart();
+    m_timeoutTimer->start(m_timeOut);
+    const char request[] = {(char)(m_round.seq >> 8), (char)(m_round.seq & 0xff),
+                            0x00, 0x00, 0x00, 0x06, (char)m_unitId,
+                            MODBUS_FC_READ_HOLDING_REGISTERS, 0x00, 0x00, 0x00, 0x01};
+    m_socket->write(request, sizeof(request));
+
+}
+
+void ModbusPing::readyRead()
+{
+
+    if (m_state != Waiting)
+        return;
+
+    //MBAP header, function code, then the byte count or the exception code
+    m_reply.append(m_socket->readAll());
+    if (m_reply.size() < 9)
+        return;
+    const int functionCode = (quint8)m_reply.at(7);
+    if (functionCode == MODBUS_FC_READ_HOLDING_REGISTERS && m_reply.size() < 11)
+        return;
+
+    //a reply that is not ours leaves modbusTime at -1 : the round is lost
+    const double elapsed = m_timer.nsecsElapsed() / 1000000.0;
+    const int tid = ((quint8)m_reply.at(0) << 8) | (quint8)m_reply.at(1);
+    if (tid != m_round.seq || (functionCode & 0x7f) != MODBUS_FC_READ_HOLDING_REGISTERS) {
+        finishRound(tr("Not a Modbus reply"));
+        return;
+    }
+
+    m_round.modbusTime = elapsed;
+    if (functionCode & 0x80)
+        finishRound(EUtils::libmodbus_strerror(MODBUS_ENOBASE + (quint8)m_reply.at(8)));
+    else
+        finishRound(tr("Register 0 = %1").arg(((quint8)m_reply.at(9) << 8) | (quint8)m_reply.at(10)));
+
+}
+
+void ModbusPing::socketError(QAbstractSocket::SocketError error)
+{
+
+    Q_UNUSED(error);
+    if (m_state == Idle)
+        return;
+    finishRound(m_socket->errorString());
+
+}
+
+void ModbusPing::timeout()
+{
+
+    if (m_state == Connecting)
+        finishRound(tr("Connect timeout"));
+    else if (m_state == Waiting)
+        finishRound(tr("No reply"));
+
+}
+
+void ModbusPing::finishRound(const QString &info)
+{
+
+    m_timeoutTimer->stop();
+    m_socket->abort();
+    m_state = Idle;
+
+    m_round.info = info;
+    m_connectTimes.append(m_round.connectTime);
+    if (m_modbus)
+        m_modbusTimes.append(m_round.modbusTime);
+    emit(roundDone(m_round));
+
+    if (m_connectTimes.size() < m_count)
+        m_intervalTimer->start();
+    else if (m_count > 0) {
+        m_count = 0;
+        emit(finished());
+    }
+
+}
+
+QString ModbusPing::stats(const QVector<double> &times, int rounds)
+{
+
+    //jitter : mean difference of consecutive times (RFC 3550 style)
+
+    int ok = 0;
+    double min = 0, max = 0, sum = 0, jitter = 0, previous = -1;
+    int pairs = 0;
+    for (int i = 0; i < times.size(); ++i) {
+        const double t = times.at(i);
+        if (t < 0)
+            continue;
+        min = ok == 0 ? t : qMin(min, t);
+        max = qMax(max, t);
+        sum += t;
+        if (previous >= 0) {
+            jitter += fabs(t - previous);
+            pairs++;
+        }
+        previous = t;
+        ok++;
+    }
+
+    QString line = tr("%1 sent, %2 ok, %3% lost").arg(rounds).arg(ok)
+                   .arg(rounds > 0 ? 100 * (rounds - ok) / rounds : 0);
+    if (ok > 0)
+        line += tr(" , min/avg/max/jitter = %1/%2/%3/%4 ms")
+                .arg(min, 0, 'f', 2).arg(sum / ok, 0, 'f', 2).arg(max, 0, 'f', 2)
+                .arg(pairs > 0 ? jitter / pairs : 0.0, 0, 'f', 2);
+    return line;
+
+}
+
+QString ModbusPing::summary()
+{
+
+    QString text = tr("TCP connect : ") + stats(m_connectTimes, m_connectTimes.size());
+    if (m_modbus)
+        text += "\n" + tr("Modbus round trip : ") + stats(m_modbusTimes, m_modbusTimes.size());
+    return text;
+
+}
@@ -0,0 +1,71 @@
+#ifndef MODBUSPING_H
+#define MODBUSPING_H
+
+#include <QObject>
+#include <QTimer>
+#include <QString>
+#include <QVector>
+#include <QElapsedTimer>
+#include <QTcpSocket>
+
+//Result of one ping round
+struct PingRound
+{
+    PingRound() : seq(0), connectTime(-1), modbusTime(-1) {}
+
+    int seq;
+    double connectTime; //ms, -1 : not connected
+    double modbusTime; //ms, -1 : no reply or not requested
+    QString info; //register 0, exception or error
+};
+
+//Reachability of a Modbus TCP device without ICMP : each round connects,
+//reads holding register 0 and disconnects. Non-blocking, on the caller
+//thread. The connect time is the network, the round trip is the device.
+class ModbusPing : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ModbusPing(QObject *parent = 0);
+    ~ModbusPing();
+
+    //modbus false : connect only (port check)
+    void start(const QString &ip, int port, int unitId, int count, int interval, int timeOut, bool modbus = true);
+    void stop();
+    bool isRunning();
+    QString summary(); //min / avg / max / jitter of the rounds done
+
+private:
+    enum State {Idle = 0, Connecting, Waiting};
+    void finishRound(const QString &info);
+    static QString stats(const QVector<double> &times, int rounds);
+    QTcpSocket *m_socket;
+    QTimer *m_timeoutTimer;
+    QTimer *m_intervalTimer;
+    QElapsedTimer m_timer;
+    QString m_ip;
+    int m_port;
+    int m_unitId;
+    int m_count;
+    int m_timeOut;
+    bool m_modbus;
+    int m_state;
+    PingRound m_round;
+    QByteArray m_reply;
+    QVector<double> m_connectTimes;
+    QVector<double> m_modbusTimes;
+
+signals:
+    void roundDone(const PingRound &round);
+    void finished();
+
+private slots:
+    void nextRound();
+    void connected();
+    void readyRead();
+    void socketError(QAbstractSocket::SocketError error);
+    void timeout();
+
+};
+
+#endif // MODBUSPING_H
@@ -0,0 +1,301 @@
+#include "modbuspipeline.h"
+
+#include "QsLog.h"
+#include <errno.h>
+
+ModbusPipeline::ModbusPipeline()
+{
+    m_depth = 1;
+    m_tid = 0;
+}
+
+void ModbusPipeline::setDepth(int depth)
+{
+    m_depth = qBound(1, depth, 64);
+}
+
+int ModbusPipeline::depth()
+{
+    return m_depth;
+}
+
+bool ModbusPipeline::canPipeline(const ModbusRequest &request)
+{
+
+    //single PDU reads and writes only
+
+    switch(request.functionCode)
+    {
+            case MODBUS_FC_READ_COILS:
+            case MODBUS_FC_READ_DISCRETE_INPUTS:
+                    return request.noOfItems >= 1 && request.noOfItems <= MODBUS_MAX_READ_BITS;
+
+            case MODBUS_FC_READ_HOLDING_REGISTERS:
+            case MODBUS_FC_READ_INPUT_REGISTERS:
+                    return request.noOfItems >= 1 && request.noOfItems <= MODBUS_MAX_READ_REGISTERS;
+
+            case MODBUS_FC_WRITE_SINGLE_COIL:
+            case MODBUS_FC_WRITE_SINGLE_REGISTER:
+                    return request.values.size() >= 1;
+
+            case MODBUS_FC_WRITE_MULTIPLE_COILS:
+                    return request.noOfItems >= 1 && request.noOfItems <= MODBUS_MAX_WRITE_BITS &&
+                           request.values.size() >= request.noOfItems;
+
+            case MODBUS_FC_WRITE_MULTIPLE_REGISTERS:
+                    return request.noOfItems >= 1 && request.noOfItems <= MODBUS_MAX_WRITE_REGISTERS &&
+                           request.values.size() >= request.noOfItems;
+
+            default:
+                    return false;
+    }
+
+}
+
+void ModbusPipeline::run(modbus_t *ctx, ModbusWorker *worker)
+{
+
+    uint32_t sec, usec;
+    ModbusRequest request;
+
+    //the response timeout of the context is changed for each receive
+    modbus_get_response_timeout(ctx, &sec, &usec);
+    m_clock.start();
+
+    for (;;) {
+        //keep the window full
+        while (m_inFlight.size() < m_depth && worker->takePipelined(request))
+            send(ctx, worker, request);
+
+        if (m_inFlight.isEmpty())
+            break;
+
+        receive(ctx, worker);
+    }
+
+    modbus_set_response_timeout(ctx, sec, usec);
+
+}
+
+void ModbusPipeline::send(modbus_t *ctx, ModbusWorker *worker, const ModbusRequest &request)
+{
+
+    Transaction transaction;
+    QByteArray pdu = buildPdu(request);
+
+    m_tid = (m_tid + 1) & 0xffff;
+    transaction.request = request;
+    transaction.tid = m_tid;
+
+    worker->takeFrames();
+    int rc = modbus_send_raw_request_tid(ctx, (uint8_t *)pdu.data(), pdu.size(), m_tid);
+    transaction.frames = worker->takeFrames();
+
+    QLOG_TRACE() <<  "Modbus Pipeline send. Transaction ID = " << m_tid << ", in flight = " << m_inFlight.size();
+
+    if (rc < 0) {
+        ModbusResult result;
+        result.request = request;
+        result.error = errno;
+        result.frames = transaction.frames;
+        worker->addResult(result);
+        return;
+    }
+
+    //MBAP header : transaction id, protocol id, length
+    transaction.adu.append((char)(m_tid >> 8));
+    transaction.adu.append((char)(m_tid & 0xff));
+    transaction.adu.append((char)0);
+    transaction.adu.append((char)0);
+    transaction.adu.append((char)((pdu.size()) >> 8));
+    transaction.adu.append((char)((pdu.size()) & 0xff));
+    transaction.adu.append(pdu);
+    transaction.deadline = m_clock.elapsed() + worker->responseTimeOut(request.slave);
+    m_inFlight.append(transaction);
+
+}
+
+void ModbusPipeline::receive(modbus_t *ctx, ModbusWorker *worker)
+{
+
+    //wait for any response until the earliest deadline
+
+    qint64 deadline = m_inFlight.first().deadline;
+    for (int i = 1; i < m_inFlight.size(); ++i)
+        deadline = qMin(deadline, m_inFlight.at(i).deadline);
+
+    const qint64 wait = deadline - m_clock.elapsed();
+    if (wait <= 0) {
+        expire(worker);
+        return;
+    }
+    modbus_set_response_timeout(ctx, wait / 1000, (wait % 1000) * 1000);
+
+    uint8_t rsp[MODBUS_TCP_MAX_ADU_LENGTH];
+    int rc = modbus_receive_confirmation(ctx, rsp);
+    QList<ModbusFrame> frames = worker->takeFrames();
+
+    if (rc < 0) {
+        if (errno == ETIMEDOUT) {
+            expire(worker);
+        }
+        else {
+            //the stream is out of step : every pending response is lost
+            int error = errno;
+            QLOG_WARN() <<  "Modbus Pipeline receive failed. errno = " << error;
+            modbus_flush(ctx);
+            failAll(worker, error);
+        }
+        return;
+    }
+
+    const int tid = (rsp[0] << 8) | rsp[1];
+    int index = -1;
+    for (int i = 0; i < m_inFlight.size(); ++i) {
+        if (m_inFlight.at(i).tid == tid) {
+            index = i;
+            break;
+        }
+    }
+    if (index < 0) {
+        //late response of a request that timed out
+        QLOG_TRACE() <<  "Modbus Pipeline unexpected Transaction ID = " << tid;
+        return;
+    }
+
+    Transaction transaction = m_inFlight.takeAt(index);
+    ModbusResult result;
+    result.request = transaction.request;
+    result.frames = transaction.frames + frames;
+    result.ret = modbus_check_confirmation(ctx, (uint8_t *)transaction.adu.data(), rsp, rc);
+    result.error = errno;
+    if (result.ret >= 0)
+        decode(rsp, modbus_get_header_length(ctx), result);
+
+    QLOG_TRACE() <<  "Modbus Pipeline receive. Transaction ID = " << tid << ", return value = " << result.ret;
+
+    worker->addResult(result);
+
+}
+
+void ModbusPipeline::expire(ModbusWorker *worker)
+{
+
+    const qint64 now = m_clock.elapsed();
+
+    for (int i = 0; i < m_inFlight.size(); ) {
+        if (m_inFlight.at(i).deadline <= now) {
+            Transaction transaction = m_inFlight.takeAt(i);
+            ModbusResult result;
+            result.request = transaction.request;
+            result.error = ETIMEDOUT;
+            result.frames = transaction.frames;
+            worker->addResult(result);
+        }
+        else
+            ++i;
+    }
+
+}
+
+void ModbusPipeline::failAll(ModbusWorker *worker, int error)
+{
+
+    while (!m_inFlight.isEmpty()) {
+        Transaction transaction = m_inFlight.takeFirst();
+        ModbusResult result;
+        result.request = transaction.request;
+        result.error = error;
+        result.frames = transaction.frames;
+        worker->addResult(result);
+    }
+
+}
+
+QByteArray ModbusPipeline::buildPdu(const ModbusRequest &request)
+{
+
+    //slave + PDU, the MBAP header is added by libmodbus
+
+    QByteArray pdu;
+    int noOfItems = request.noOfItems;
+
+    pdu.append((char)request.slave);
+    pdu.append((char)request.functionCode);
+    pdu.append((char)(request.startAddr >> 8));
+    pdu.append((char)(request.startAddr & 0xff));
+
+    switch(request.functionCode)
+    {
+            case MODBUS_FC_WRITE_SINGLE_COIL:
+                    pdu.append((char)(request.values[0] ? 0xff : 0x00));
+                    pdu.append((char)0x00);
+                    break;
+
+            case MODBUS_FC_WRITE_SINGLE_REGISTER:
+                    pdu.append((char)(request.values[0] >> 8));
+                    pdu.append((char)(request.values[0] & 0xff));
+                    break;
+
+            case MODBUS_FC_WRITE_MULTIPLE_COILS:
+            {
+                    QByteArray bits((noOfItems + 7) / 8, 0);
+                    for (int i = 0; i < noOfItems; ++i) {
+                        if (request.values[i])
+                            bits[i / 8] = bits.at(i / 8) | (1 << (i % 8));
+                    }
+                    pdu.append((char)(noOfItems >> 8));
+                    pdu.append((char)(noOfItems & 0xff));
+                    pdu.append((char)bits.size());
+                    pdu.append(bits);
+                    break;
+            }
+            case MODBUS_FC_WRITE_MULTIPLE_REGISTERS:
+                    pdu.append((char)(noOfItems >> 8));
+                    pdu.append((char)(noOfItems & 0xff));
+                    pdu.append((char)(noOfItems * 2));
+                    for (int i = 0; i < noOfItems; ++i) {
+                        pdu.append((char)(request.values[i] >> 8));
+                        pdu.append((char)(request.values[i] & 0xff));
+                    }
+                    break;
+
+            default: //reads
+                    pdu.append((char)(noOfItems >> 8));
+                    pdu.append((char)(noOfItems & 0xff));
+                    break;
+    }
+
+    return pdu;
+
+}
+
+void ModbusPipeline::decode(const uint8_t *rsp, int offset, ModbusResult &result)
+{
+
+    //values of a checked response, same as the libmodbus read functions
+
+    const int noOfItems = result.request.noOfItems;
+
+    switch(result.request.functionCode)
+    {
+            case MODBUS_FC_READ_COILS:
+            case MODBUS_FC_READ_DISCRETE_INPUTS:
+                    result.ret = noOfItems; //byte count in the response
+                    result.data.resize(noOfItems);
+                    for (int i = 0; i < noOfItems; ++i)
+                        result.data[i] = (rsp[offset + 2 + i / 8] >> (i % 8)) & 1;
+                    break;
+
+            case MODBUS_FC_READ_HOLDING_REGISTERS:
+            case MODBUS_FC_READ_INPUT_REGISTERS:
+                    result.data.resize(result.ret);
+                    for (int i = 0; i < result.ret; ++i)
+                        result.data[i] = (rsp[offset + 2 + (i << 1)] << 8) | rsp[offset + 3 + (i << 1)];
+                    break;
+
+            default:
+                    break;
+    }
+
+}
@@ -0,0 +1,46 @@
+#ifndef MODBUSPIPELINE_H
+#define MODBUSPIPELINE_H
+
+#include <QList>
+#include <QByteArray>
+#include <QElapsedTimer>
+#include "modbusworker.h"
+
+//Modbus TCP requests sent without waiting for the previous responses.
+//Responses are matched by MBAP transaction id, in any order, and every
+//request has its own response timeout, the one learned for its slave.
+class ModbusPipeline
+{
+public:
+    ModbusPipeline();
+
+    void setDepth(int depth);
+    int depth();
+    static bool canPipeline(const ModbusRequest &request);
+    //runs on the worker thread until no pipelined request is left
+    void run(modbus_t *ctx, ModbusWorker *worker);
+
+private:
+    struct Transaction
+    {
+        ModbusRequest request;
+        int tid;
+        QByteArray adu; //request with the MBAP header, to check the response
+        qint64 deadline;
+        QList<ModbusFrame> frames;
+    };
+
+    void send(modbus_t *ctx, ModbusWorker *worker, const ModbusRequest &request);
+    void receive(modbus_t *ctx, ModbusWorker *worker);
+    void expire(ModbusWorker *worker);
+    void failAll(ModbusWorker *worker, int error);
+    static QByteArray buildPdu(const ModbusRequest &request);
+    static void decode(const uint8_t *rsp, int offset, ModbusResult &result);
+    int m_depth; //max number of requests in flight
+    int m_tid;
+    QList<Transaction> m_inFlight;
+    QElapsedTimer m_clock;
+
+};
+
+#endif // MODBUSPIPELINE_H
@@ -0,0 +1,302 @@
+#include "modbusscheduler.h"
+#include "modbusadapter.h"
+
+#include "QsLog.h"
+
+//tag = generation << TagShift | block id - 15 bit generation : the tag stays positive
+static const int TagShift = 16;
+static const int TagMask = 0xffff;
+static const int GenerationMask = 0x7fff;
+//entries due within period / LookAhead are read early when they fit in a due request
+static const int LookAhead = 4;
+
+ModbusScheduler::ModbusScheduler(ModbusAdapter *adapter, QObject *parent) :
+    QObject(parent),
+    m_adapter(adapter)
+{
+    m_maxInFlight = 1; //more than one with pipelined TCP
+    m_generation = 0;
+    m_blockId = 0;
+    m_running = false;
+    m_timer = new QTimer(this);
+    m_timer->setSingleShot(true);
+    m_timer->setTimerType(Qt::PreciseTimer);
+    m_clock.start();
+    connect(m_timer,SIGNAL(timeout()),this,SLOT(dispatch()));
+    connect(m_adapter,SIGNAL(transactionDone(ModbusResult)),this,SLOT(transactionDone(ModbusResult)));
+}
+
+QList<ScanEntry> ModbusScheduler::entries()
+{
+    return m_entries;
+}
+
+void ModbusScheduler::setEntries(const QList<ScanEntry> &entries)
+{
+    m_entries = entries;
+    resetDeadlines();
+}
+
+void ModbusScheduler::addEntry(const ScanEntry &entry)
+{
+    m_entries.append(entry);
+    resetDeadlines();
+}
+
+void ModbusScheduler::setEntry(int index, const ScanEntry &entry)
+{
+    if (index < 0 || index >= m_entries.size())
+        return;
+    //the request in flight reads the old range, possibly on another device
+    m_entries[index] = entry;
+    resetDeadlines();
+}
+
+void ModbusScheduler::removeEntry(int index)
+{
+    if (index < 0 || index >= m_entries.size())
+        return;
+    m_entries.removeAt(index);
+    resetDeadlines();
+}
+
+int ModbusScheduler::count()
+{
+    return m_entries.size();
+}
+
+bool ModbusScheduler::isRunning()
+{
+    return m_running;
+}
+
+void ModbusScheduler::setMaxGap(int maxGap)
+{
+    m_coalescer.setMaxGap(maxGap);
+}
+
+void ModbusScheduler::setMaxInFlight(int maxInFlight)
+{
+    m_maxInFlight = qMax(1, maxInFlight);
+}
+
+void ModbusScheduler::start()
+{
+
+    QLOG_INFO() <<  "Scan list started. Entries = " << m_entries.size();
+
+    if (m_entries.isEmpty())
+        return;
+
+    m_running = true;
+    resetDeadlines();
+    emit(runningChanged(true));
+    dispatch();
+
+}
+
+void ModbusScheduler::stop()
+{
+
+    if (!m_running)
+        return;
+
+    QLOG_INFO() <<  "Scan list stopped";
+
+    m_running = false;
+    m_timer->stop();
+    resetDeadlines();
+    emit(runningChanged(false));
+
+}
+
+void ModbusScheduler::resetDeadlines()
+{
+
+    //results of requests posted before the reset are ignored, they still
+    //count in m_deviceInFlight until they come back : no new wave on top
+    m_generation = (m_generation + 1) & GenerationMask;
+    m_blocks.clear();
+    m_release.fill(m_clock.elapsed(), m_entries.size());
+    m_inFlight.fill(false, m_entries.size());
+    //one pool reference per entry - the devices no entry uses any more are closed
+    const QVector<int> previous = m_device;
+    m_device.resize(m_entries.size());
+    for (int i = 0; i < m_entries.size(); ++i)
+        m_device[i] = m_adapter->device(m_entries.at(i).ip, m_entries.at(i).port);
+    for (int i = 0; i < previous.size(); ++i)
+        m_adapter->releaseDevice(previous.at(i));
+    //the queue of a released device is dropped, its requests never come back
+    for (int i = 0; i < previous.size(); ++i) {
+        if (previous.at(i) > 0 && !m_device.contains(previous.at(i)))
+            m_deviceInFlight.remove(previous.at(i));
+    }
+
+}
+
+void ModbusScheduler::requestsDropped()
+{
+
+    //the connection dropped its queued requests - only the transaction on
+    //the wire may still come back, its count goes no lower than 0
+
+    m_deviceInFlight.clear();
+
+}
+
+void ModbusScheduler::dispatch()
+{
+
+    //Post due entries, earliest deadline (release + period) first
+
+    if (!m_running)
+        return;
+
+    const qint64 now = m_clock.elapsed();
+    for (;;) {
+        int next = -1;
+        for (int i = 0; i < m_entries.size(); ++i) {
+            if (m_inFlight[i] || m_release[i] > now || !hasCapacity(m_device[i]))
+                continue;
+            if (next < 0 || m_release[i] + m_entries[i].period < m_release[next] + m_entries[next].period)
+                next = i;
+        }
+        if (next < 0)
+            break;
+
+        ModbusBlock block = nextBlock(next, now);
+        const int blockId = m_blockId;
+        m_blockId = (m_blockId + 1) & TagMask;
+
+        ModbusRequest request;
+        request.origin = ModbusRequest::Scan;
+        request.tag = (m_generation << TagShift) | blockId;
+        request.device = m_device[next];
+        request.slave = block.slave;
+        request.functionCode = block.functionCode;
+        request.startAddr = block.startAddr;
+        request.noOfItems = block.noOfItems;
+        //edited setpoints of the slave ride on the read when it supports FC 0x17
+        m_adapter->pairWrite(request);
+
+        m_blocks.insert(blockId, block);
+        m_deviceInFlight[request.device]++;
+        for (int i = 0; i < block.ranges.size(); ++i) {
+            const int index = block.ranges.at(i).id;
+            m_inFlight[index] = true;
+            //skip missed cycles instead of bursting to catch up
+            m_release[index] += m_entries.at(index).period;
+            if (m_release[index] < now)
+                m_release[index] = now;
+        }
+
+        m_adapter->submit(request);
+    }
+
+    armTimer();
+
+}
+
+ModbusBlock ModbusScheduler::nextBlock(int next, qint64 now)
+{
+
+    //Merge the entry with the entries of the same slave and function code
+    //that are due or due soon, return the request that serves it
+
+    QList<ModbusRange> ranges;
+    const ScanEntry &entry = m_entries.at(next);
+
+    for (int i = 0; i < m_entries.size(); ++i) {
+        const ScanEntry &candidate = m_entries.at(i);
+        if (i != next) {
+            if (m_inFlight[i] ||
+                m_device[i] != m_device[next] ||
+                candidate.slave != entry.slave ||
+                candidate.functionCode != entry.functionCode ||
+                m_release[i] > now + candidate.period / LookAhead)
+                continue;
+        }
+        ModbusRange range;
+        range.id = i;
+        range.slave = candidate.slave;
+        range.functionCode = candidate.functionCode;
+        range.startAddr = candidate.startAddr;
+        range.noOfItems = candidate.noOfItems;
+        ranges.append(range);
+    }
+
+    QList<ModbusBlock> blocks = m_coalescer.coalesce(ranges);
+    for (int i = 0; i < blocks.size(); ++i) {
+        for (int j = 0; j < blocks.at(i).ranges.size(); ++j) {
+            if (blocks.at(i).ranges.at(j).id == next)
+                return blocks.at(i);
+        }
+    }
+
+    return ModbusBlock();
+
+}
+
+bool ModbusScheduler::hasCapacity(int device)
+{
+
+    //the pool devices run one request at a time
+
+    return m_deviceInFlight.value(device) < (device == 0 ? m_maxInFlight : 1);
+
+}
+
+void ModbusScheduler::armTimer()
+{
+
+    //wake up at the next release time - completions wake us up too
+    qint64 next = -1;
+    for (int i = 0; i < m_entries.size(); ++i) {
+        if (m_inFlight[i] || !hasCapacity(m_device[i]))
+            continue;
+        if (next < 0 || m_release[i] < next)
+            next = m_release[i];
+    }
+
+    if (next < 0)
+        m_timer->stop();
+    else
+        m_timer->start(qMax<qint64>(0, next - m_clock.elapsed()));
+
+}
+
+void ModbusScheduler::transactionDone(const ModbusResult &result)
+{
+
+    if (result.request.origin != ModbusRequest::Scan)
+        return;
+
+    const int blockId = result.request.tag & TagMask;
+    const int generation = (result.request.tag >> TagShift) & GenerationMask;
+    if (m_deviceInFlight.value(result.request.device) > 0)
+        m_deviceInFlight[result.request.device]--;
+    if (generation != m_generation || !m_blocks.contains(blockId)) {
+        //a request of a previous generation frees its device
+        dispatch();
+        return;
+    }
+
+    ModbusBlock block = m_blocks.take(blockId);
+
+    //the entries see the read of a FC 0x17 request - the adapter reports the write
+    ModbusResult read = result;
+    read.request.functionCode = block.functionCode;
+    read.request.values.clear();
+
+    //one result per entry served by the request
+    for (int i = 0; i < block.ranges.size(); ++i) {
+        const ModbusRange &range = block.ranges.at(i);
+        if (range.id >= m_entries.size())
+            continue;
+        m_inFlight[range.id] = false;
+        emit(entryUpdated(range.id, ModbusCoalescer::scatter(read, range)));
+    }
+
+    dispatch();
+
+}
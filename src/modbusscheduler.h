@@ -0,0 +1,81 @@
+#ifndef MODBUSSCHEDULER_H
+#define MODBUSSCHEDULER_H
+
+#include <QObject>
+#include <QList>
+#include <QVector>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QString>
+#include "modbusworker.h"
+#include "modbuscoalescer.h"
+
+class ModbusAdapter;
+
+//Block of items polled periodically
+struct ScanEntry
+{
+    ScanEntry() : port(502), slave(1), functionCode(MODBUS_FC_READ_HOLDING_REGISTERS),
+                  startAddr(0), noOfItems(1), period(1000) {}
+
+    QString ip; //TCP device polled in parallel, empty : the current connection
+    int port;
+    int slave;
+    int functionCode;
+    int startAddr;
+    int noOfItems;
+    int period; //ms
+};
+
+//Polls the scan list with earliest-deadline-first ordering
+class ModbusScheduler : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ModbusScheduler(ModbusAdapter *adapter, QObject *parent = 0);
+
+    QList<ScanEntry> entries();
+    void setEntries(const QList<ScanEntry> &entries);
+    void addEntry(const ScanEntry &entry);
+    void setEntry(int index, const ScanEntry &entry);
+    void removeEntry(int index);
+    int count();
+    bool isRunning();
+    void setMaxGap(int maxGap);
+    void setMaxInFlight(int maxInFlight);
+    void start();
+    void stop();
+    void requestsDropped();
+
+signals:
+    void entryUpdated(int index, const ModbusResult &result);
+    void runningChanged(bool running);
+
+private slots:
+    void dispatch();
+    void transactionDone(const ModbusResult &result);
+
+private:
+    void resetDeadlines();
+    void armTimer();
+    ModbusBlock nextBlock(int next, qint64 now);
+    bool hasCapacity(int device);
+    ModbusAdapter *m_adapter;
+    QList<ScanEntry> m_entries;
+    QVector<qint64> m_release; //next poll time of each entry
+    QVector<bool> m_inFlight;
+    QVector<int> m_device; //connection of each entry
+    QHash<int, int> m_deviceInFlight; //requests in flight by connection
+    int m_maxInFlight;
+    int m_generation;
+    int m_blockId;
+    QHash<int, ModbusBlock> m_blocks; //in flight requests by block id
+    ModbusCoalescer m_coalescer;
+    bool m_running;
+    QElapsedTimer m_clock;
+    QTimer *m_timer;
+
+};
+
+#endif // MODBUSSCHEDULER_H
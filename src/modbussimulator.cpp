@@ -0,0 +1,329 @@
+#include "modbussimulator.h"
+
+#include "QsLog.h"
+#include <QList>
+#include <errno.h>
+#include <stdlib.h>
+
+#ifdef Q_OS_WIN32
+#include <winsock2.h>
+#else
+#include <sys/select.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <termios.h>
+#endif
+
+//select() wakes up at this period to check for stop requests
+static const int StopPollTime = 100; //ms
+
+ModbusSimulator::ModbusSimulator(QObject *parent) :
+    QThread(parent)
+{
+    m_modbus = NULL;
+    m_mapping = NULL;
+    m_listen = -1;
+}
+
+ModbusSimulator::~ModbusSimulator()
+{
+    stopSimulator();
+}
+
+bool ModbusSimulator::startSimulator(const SimulatorConfig &config)
+{
+
+    QLOG_INFO()<<  "Simulator start. Mode = " << config.mode << " , slave = " << config.slave;
+
+    stopSimulator();
+    m_config = config;
+    m_errorString.clear();
+    m_requests = 0;
+    m_replies = 0;
+    m_errors = 0;
+    m_stop = 0;
+
+    //registers = their address, coils alternate
+    const int items = qBound(1, config.noOfItems, 65536 - qBound(0, config.startAddr, 65535));
+    m_mapping = modbus_mapping_new_start_address(config.startAddr, items, config.startAddr, items,
+                                                 config.startAddr, items, config.startAddr, items);
+    if (m_mapping == NULL) {
+        m_errorString = tr("Unable to allocate the register map.");
+        return false;
+    }
+    for (int i = 0; i < items; ++i) {
+        m_mapping->tab_bits[i] = i % 2;
+        m_mapping->tab_input_bits[i] = (i + 1) % 2;
+        m_mapping->tab_registers[i] = config.startAddr + i;
+        m_mapping->tab_input_registers[i] = config.startAddr + i;
+    }
+
+    if (!(config.mode == SimulatorConfig::RTU ? openRTU() : openTCP())) {
+        closeAll();
+        return false;
+    }
+
+    start();
+    return true;
+
+}
+
+void ModbusSimulator::stopSimulator()
+{
+
+    if (isRunning()) {
+        QLOG_INFO()<<  "Simulator stop";
+        m_stop = 1;
+        wait();
+    }
+    closeAll();
+
+}
+
+bool ModbusSimulator::openTCP()
+{
+
+    m_modbus = modbus_new_tcp("127.0.0.1", m_config.port);
+    if (m_modbus == NULL) {
+        m_errorString = tr("Unable to create the libmodbus context.");
+        return false;
+    }
+
+    m_listen = modbus_tcp_listen(m_modbus, 8);
+    if (m_listen == -1) {
+        m_errorString = tr("Could not listen on TCP port %1.").arg(m_config.port);
+        return false;
+    }
+
+    m_address = QString("127.0.0.1:%1").arg(m_config.port);
+    return true;
+
+}
+
+bool ModbusSimulator::openRTU()
+{
+
+#ifdef Q_OS_WIN32
+    m_errorString = tr("RTU simulation needs pseudo terminals, not available on Windows.");
+    return false;
+#else
+    //the simulator owns the master side, the master application opens the slave device
+    int fd = posix_openpt(O_RDWR | O_NOCTTY);
+    if (fd == -1 || grantpt(fd) == -1 || unlockpt(fd) == -1) {
+        if (fd != -1)
+            ::close(fd);
+        m_errorString = tr("Unable to create a pseudo terminal.");
+        return false;
+    }
+
+    struct termios tios;
+    tcgetattr(fd, &tios);
+    cfmakeraw(&tios);
+    tcsetattr(fd, TCSANOW, &tios);
+    m_address = QString(ptsname(fd));
+
+    //libmodbus only reads and writes the descriptor, the device name is unused
+    m_modbus = modbus_new_rtu(m_address.toLatin1().constData(), 115200, 'N', 8, 1, 0);
+    if (m_modbus == NULL) {
+        ::close(fd);
+        m_errorString = tr("Unable to create the libmodbus context.");
+        return false;
+    }
+    modbus_set_socket(m_modbus, fd);
+    modbus_set_slave(m_modbus, m_config.slave);
+
+    return true;
+#endif
+
+}
+
+void ModbusSimulator::closeAll()
+{
+
+    if (m_listen != -1) {
+#ifdef Q_OS_WIN32
+        closesocket(m_listen);
+#else
+        ::close(m_listen);
+#endif
+        m_listen = -1;
+    }
+    if (m_modbus != NULL) {
+#ifndef Q_OS_WIN32
+        //the pseudo terminal was not opened by libmodbus, there are no line settings to restore
+        if (m_config.mode == SimulatorConfig::RTU) {
+            ::close(modbus_get_socket(m_modbus));
+            modbus_set_socket(m_modbus, -1);
+        }
+#endif
+        modbus_close(m_modbus);
+        modbus_free(m_modbus);
+        m_modbus = NULL;
+    }
+    if (m_mapping != NULL) {
+        modbus_mapping_free(m_mapping);
+        m_mapping = NULL;
+    }
+
+}
+
+void ModbusSimulator::run()
+{
+
+    if (m_config.mode == SimulatorConfig::RTU)
+        runRTU();
+    else
+        runTCP();
+
+}
+
+bool ModbusSimulator::serve(modbus_t *ctx)
+{
+
+    //One request - false when the link is lost
+
+    uint8_t query[MODBUS_TCP_MAX_ADU_LENGTH];
+    int rc = modbus_receive(ctx, query);
+    if (rc == -1) //bad frames are ignored like a real slave would
+        return (errno != EIO && errno != EBADF && errno != ECONNRESET);
+    if (rc == 0) //request for another slave
+        return true;
+
+    m_requests.ref();
+
+    //error injection
+    const int roll = qrand() % 100;
+    if (roll < m_config.dropRate) {
+        m_errors.ref();
+        return true;
+    }
+
+    int delay = m_config.delay;
+    if (m_config.jitter > 0)
+        delay += qrand() % (m_config.jitter + 1);
+    if (delay > 0)
+        msleep(delay);
+
+    if (roll < m_config.dropRate + m_config.exceptionRate) {
+        m_errors.ref();
+        modbus_reply_exception(ctx, query, MODBUS_EXCEPTION_SLAVE_OR_SERVER_BUSY);
+        return true;
+    }
+
+    if (modbus_reply(ctx, query, rc, m_mapping) == -1)
+        return false;
+    m_replies.ref();
+
+    return true;
+
+}
+
+void ModbusSimulator::runTCP()
+{
+
+    //one context per client keeps the bytes read ahead (pipelined requests) of each connection
+    QList<modbus_t *> clients;
+    qsrand((uint)(quintptr)this);
+
+    while (!m_stop.load()) {
+        fd_set rset;
+        struct timeval tv;
+        int maxFd = m_listen;
+
+        FD_ZERO(&rset);
+        FD_SET(m_listen, &rset);
+        for (int i = 0; i < clients.size(); ++i) {
+            FD_SET(modbus_get_socket(clients.at(i)), &rset);
+            maxFd = qMax(maxFd, modbus_get_socket(clients.at(i)));
+        }
+        tv.tv_sec = 0;
+        tv.tv_usec = StopPollTime * 1000;
+        if (select(maxFd + 1, &rset, NULL, NULL, &tv) <= 0)
+            continue;
+
+        if (FD_ISSET(m_listen, &rset)) {
+            int s = accept(m_listen, NULL, NULL);
+            if (s != -1) {
+                modbus_t *client = modbus_new_tcp("127.0.0.1", m_config.port);
+                modbus_set_socket(client, s);
+                clients.append(client);
+                QLOG_INFO()<<  "Simulator client connected. Clients = " << clients.size();
+            }
+        }
+
+        for (int i = clients.size() - 1; i >= 0; --i) {
+            modbus_t *client = clients.at(i);
+            if (!FD_ISSET(modbus_get_socket(client), &rset))
+                continue;
+            bool ok;
+            do {
+                ok = serve(client);
+            } while (ok && modbus_get_rx_pending(client) > 0 && !m_stop.load());
+            if (!ok) {
+                modbus_close(client);
+                modbus_free(client);
+                clients.removeAt(i);
+                QLOG_INFO()<<  "Simulator client disconnected. Clients = " << clients.size();
+            }
+        }
+    }
+
+    for (int i = 0; i < clients.size(); ++i) {
+        modbus_close(clients.at(i));
+        modbus_free(clients.at(i));
+    }
+
+}
+
+void ModbusSimulator::runRTU()
+{
+
+    int fd = modbus_get_socket(m_modbus);
+    qsrand((uint)(quintptr)this);
+
+    while (!m_stop.load()) {
+        fd_set rset;
+        struct timeval tv;
+
+        FD_ZERO(&rset);
+        FD_SET(fd, &rset);
+        tv.tv_sec = 0;
+        tv.tv_usec = StopPollTime * 1000;
+        if (select(fd + 1, &rset, NULL, NULL, &tv) <= 0)
+            continue;
+
+        //a read error on the master side means the slave side is not open, keep waiting
+        bool ok;
+        do {
+            ok = serve(m_modbus);
+        } while (ok && modbus_get_rx_pending(m_modbus) > 0 && !m_stop.load());
+        if (!ok)
+            msleep(StopPollTime);
+    }
+
+}
+
+QString ModbusSimulator::address()
+{
+    return m_address;
+}
+
+QString ModbusSimulator::errorString()
+{
+    return m_errorString;
+}
+
+int ModbusSimulator::requests()
+{
+    return m_requests.load();
+}
+
+int ModbusSimulator::replies()
+{
+    return m_replies.load();
+}
+
+int ModbusSimulator::errors()
+{
+    return m_errors.load();
+}
@@ -0,0 +1,68 @@
+#ifndef MODBUSSIMULATOR_H
+#define MODBUSSIMULATOR_H
+
+#include <QThread>
+#include <QString>
+#include <QAtomicInt>
+#include "modbus.h"
+
+//Simulated slave settings
+struct SimulatorConfig
+{
+    enum Mode {TCP = 0, RTU = 1};
+
+    SimulatorConfig() : mode(TCP), port(1502), slave(1), startAddr(0), noOfItems(10000),
+                        delay(0), jitter(0), dropRate(0), exceptionRate(0) {}
+
+    int mode;
+    int port; //TCP port on localhost
+    int slave;
+    int startAddr; //same map for coils, discrete inputs, holding and input registers
+    int noOfItems;
+    int delay; //ms before each response
+    int jitter; //ms, random delay added to delay
+    int dropRate; //% of requests not answered
+    int exceptionRate; //% of requests answered with an exception
+};
+
+//Loopback Modbus slave - TCP on localhost or RTU over a pseudo terminal
+//Serves the requests on its own thread with libmodbus modbus_reply
+class ModbusSimulator : public QThread
+{
+    Q_OBJECT
+public:
+    explicit ModbusSimulator(QObject *parent = 0);
+    ~ModbusSimulator();
+
+    bool startSimulator(const SimulatorConfig &config);
+    void stopSimulator();
+    QString address(); //"127.0.0.1:port" or the pseudo terminal device
+    QString errorString();
+    int requests();
+    int replies();
+    int errors(); //dropped requests and exceptions injected
+
+protected:
+    void run();
+
+private:
+    bool openTCP();
+    bool openRTU();
+    void closeAll();
+    bool serve(modbus_t *ctx);
+    void runTCP();
+    void runRTU();
+    SimulatorConfig m_config;
+    modbus_t *m_modbus; //listening context (TCP) or the pseudo terminal master (RTU)
+    modbus_mapping_t *m_mapping;
+    int m_listen;
+    QString m_address;
+    QString m_errorString;
+    QAtomicInt m_stop;
+    QAtomicInt m_requests;
+    QAtomicInt m_replies;
+    QAtomicInt m_errors;
+
+};
+
+#endif // MODBUSSIMULATOR_H
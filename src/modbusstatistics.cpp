@@ -0,0 +1,248 @@
+#include "modbusstatistics.h"
+
+#include <QThread>
+#include <QElapsedTimer>
+
+//Values above are counted in the last bucket
+static const qint64 MaxValue = 0x7fffffff; //us
+
+LatencyHistogram::LatencyHistogram()
+{
+    reset();
+}
+
+int LatencyHistogram::bucketIndex(qint64 us)
+{
+
+    //values below SubBuckets have a bucket each, then SubBuckets buckets
+    //per power of two
+
+    if (us < 0)
+        us = 0;
+    if (us > MaxValue)
+        us = MaxValue;
+    if (us < SubBuckets)
+        return (int)us;
+
+    int shift = 0;
+    while ((us >> shift) >= 2 * SubBuckets)
+        shift++;
+    const int index = SubBuckets * (shift + 1) + (int)(us >> shift) - SubBuckets;
+    return qMin(index, (int)Buckets - 1);
+
+}
+
+qint64 LatencyHistogram::bucketValue(int index)
+{
+    if (index < SubBuckets)
+        return index;
+    const int shift = index / SubBuckets - 1;
+    const qint64 sub = index % SubBuckets;
+    return ((SubBuckets + sub + 1) << shift) - 1;
+}
+
+void LatencyHistogram::record(qint64 us)
+{
+
+    if (us > MaxValue)
+        us = MaxValue;
+    if (us < 0)
+        us = 0;
+
+    m_counts[bucketIndex(us)].fetchAndAddRelaxed(1);
+    m_count.fetchAndAddRelaxed(1);
+
+    //min and max : retry if another worker changed them meanwhile
+    int current = m_min.loadAcquire();
+    while (us < current && !m_min.testAndSetOrdered(current, (int)us))
+        current = m_min.loadAcquire();
+    current = m_max.loadAcquire();
+    while (us > current && !m_max.testAndSetOrdered(current, (int)us))
+        current = m_max.loadAcquire();
+
+}
+
+void LatencyHistogram::reset()
+{
+    for (int i = 0; i < Buckets; ++i)
+        m_counts[i].storeRelease(0);
+    m_count.storeRelease(0);
+    m_min.storeRelease((int)MaxValue);
+    m_max.storeRelease(0);
+}
+
+int LatencyHistogram::count() const
+{
+    return m_count.loadAcquire();
+}
+
+qint64 LatencyHistogram::min() const
+{
+    return count() > 0 ? m_min.loadAcquire() : 0;
+}
+
+qint64 LatencyHistogram::max() const
+{
+    return m_max.loadAcquire();
+}
+
+qint64 LatencyHistogram::mean() const
+{
+
+    //bucket middles - within the bucket resolution
+
+    qint64 sum = 0;
+    qint64 n = 0;
+    for (int i = 0; i < Buckets; ++i) {
+        const int c = m_counts[i].loadAcquire();
+        if (c == 0)
+            continue;
+        const qint64 low = i > 0 ? bucketValue(i - 1) + 1 : 0;
+        sum += c * ((low + bucketValue(i)) / 2);
+        n += c;
+    }
+
+    return n > 0 ? sum / n : 0;
+
+}
+
+qint64 LatencyHistogram::percentile(double p) const
+{
+
+    //upper bound of the bucket holding the p-th value, clamped to max
+
+    const int n = count();
+    if (n == 0)
+        return 0;
+
+    qint64 target = (qint64)(p / 100.0 * n + 0.5);
+    if (target < 1)
+        target = 1;
+
+    qint64 seen = 0;
+    for (int i = 0; i < Buckets; ++i) {
+        seen += m_counts[i].loadAcquire();
+        if (seen >= target)
+            return qMin(bucketValue(i), max());
+    }
+
+    return max();
+
+}
+
+ModbusStatistics::ModbusStatistics()
+{
+    for (int i = 0; i < MaxEntries; ++i) {
+        m_keys[i].storeRelease(0);
+        m_entries[i].storeRelease(NULL);
+    }
+}
+
+ModbusStatistics::~ModbusStatistics()
+{
+    for (int i = 0; i < MaxEntries; ++i)
+        delete m_entries[i].loadAcquire();
+}
+
+static QElapsedTimer startClock()
+{
+    QElapsedTimer clock;
+    clock.start();
+    return clock;
+}
+
+qint64 ModbusStatistics::now()
+{
+    static const QElapsedTimer clock = startClock();
+    return clock.nsecsElapsed();
+}
+
+ModbusTimingEntry *ModbusStatistics::entry(int device, int slave, int functionCode)
+{
+
+    //find or claim the slot of the key - linear probing, no locks
+    //key 0 marks a free slot
+
+    const int key = (((device & 0x7fff) << 16) | ((slave & 0xff) << 8) | (functionCode & 0xff)) + 1;
+    int slot = (int)(((quint32)key * 2654435761u) % MaxEntries);
+
+    for (int i = 0; i < MaxEntries; ++i, slot = (slot + 1) % MaxEntries) {
+        int current = m_keys[slot].loadAcquire();
+        if (current == 0) {
+            if (m_keys[slot].testAndSetOrdered(0, key)) {
+                ModbusTimingEntry *e = new ModbusTimingEntry();
+                e->device = device;
+                e->slave = slave;
+                e->functionCode = functionCode;
+                m_entries[slot].storeRelease(e);
+                return e;
+            }
+            current = m_keys[slot].loadAcquire();
+        }
+        if (current == key) {
+            //claimed by another worker, published right after
+            ModbusTimingEntry *e;
+            while ((e = m_entries[slot].loadAcquire()) == NULL)
+                QThread::yieldCurrentThread();
+            return e;
+        }
+    }
+
+    return NULL; //table full
+
+}
+
+void ModbusStatistics::record(int device, int slave, int functionCode, bool ok,
+                              qint64 queued, qint64 sent, qint64 firstByte, qint64 done)
+{
+
+    //timestamps in ns from now(), 0 when the step was not reached
+
+    ModbusTimingEntry *e = entry(device, slave, functionCode);
+    if (e == NULL)
+        return;
+
+    if (!ok) {
+        e->errors.fetchAndAddRelaxed(1);
+        return;
+    }
+
+    if (queued > 0 && sent > 0)
+        e->queue.record((sent - queued) / 1000);
+    if (sent > 0 && firstByte > 0)
+        e->response.record((firstByte - sent) / 1000);
+    if (firstByte > 0 && done > 0)
+        e->transfer.record((done - firstByte) / 1000);
+    if (queued > 0 && done > 0)
+        e->total.record((done - queued) / 1000);
+
+}
+
+QList<const ModbusTimingEntry *> ModbusStatistics::entries() const
+{
+    QList<const ModbusTimingEntry *> list;
+    for (int i = 0; i < MaxEntries; ++i) {
+        const ModbusTimingEntry *e = m_entries[i].loadAcquire();
+        if (e != NULL)
+            list.append(e);
+    }
+    return list;
+}
+
+void ModbusStatistics::reset()
+{
+
+    //counters are cleared in place - the workers may be recording
+
+    for (int i = 0; i < MaxEntries; ++i) {
+        ModbusTimingEntry *e = m_entries[i].loadAcquire();
+        if (e == NULL)
+            continue;
+        e->errors.storeRelease(0);
+        e->queue.reset();
+        e->response.reset();
+        e->transfer.reset();
+        e->total.reset();
+    }
+
+}
@@ -0,0 +1,77 @@
+#ifndef MODBUSSTATISTICS_H
+#define MODBUSSTATISTICS_H
+
+#include <QAtomicInt>
+#include <QAtomicPointer>
+#include <QList>
+
+//Log-linear latency histogram (HDR style) : 32 buckets per power of two,
+//about 3% resolution from 1 us to more than 30 min
+//Written from the worker threads, read from the GUI thread - no locks
+class LatencyHistogram
+{
+public:
+    LatencyHistogram();
+
+    enum {SubBucketBits = 5, SubBuckets = 1 << SubBucketBits, Buckets = SubBuckets * 27};
+
+    void record(qint64 us);
+    void reset();
+    int count() const;
+    qint64 min() const;
+    qint64 max() const;
+    qint64 mean() const;
+    qint64 percentile(double p) const; //p in 0..100, us
+
+    static int bucketIndex(qint64 us);
+    static qint64 bucketValue(int index); //upper bound of the bucket, us
+
+private:
+    QAtomicInt m_counts[Buckets];
+    QAtomicInt m_count;
+    QAtomicInt m_min;
+    QAtomicInt m_max;
+
+};
+
+//Timing of one (device, slave, function code)
+struct ModbusTimingEntry
+{
+    ModbusTimingEntry() : device(0), slave(0), functionCode(0) {}
+
+    int device;
+    int slave;
+    int functionCode;
+    QAtomicInt errors;
+    LatencyHistogram queue; //enqueued -> sent : our own stack
+    LatencyHistogram response; //sent -> first response byte : device or gateway
+    LatencyHistogram transfer; //first byte -> complete : link speed
+    LatencyHistogram total; //enqueued -> complete
+};
+
+//Per slave and function code transaction timing, filled by the workers
+class ModbusStatistics
+{
+public:
+    ModbusStatistics();
+    ~ModbusStatistics();
+
+    enum {MaxEntries = 1024};
+
+    //monotonic time, ns - the timestamps of requests and frames
+    static qint64 now();
+
+    void record(int device, int slave, int functionCode, bool ok,
+                qint64 queued, qint64 sent, qint64 firstByte, qint64 done);
+    QList<const ModbusTimingEntry *> entries() const;
+    void reset();
+
+private:
+    ModbusTimingEntry *entry(int device, int slave, int functionCode);
+    //open addressing table, a slot is claimed once and never freed
+    QAtomicInt m_keys[MaxEntries];
+    QAtomicPointer<ModbusTimingEntry> m_entries[MaxEntries];
+
+};
+
+#endif // MODBUSSTATISTICS_H
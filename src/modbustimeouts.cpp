@@ -0,0 +1,76 @@
+#include "modbustimeouts.h"
+
+#include "QsLog.h"
+#include <math.h>
+
+ModbusTimeOuts::ModbusTimeOuts()
+{
+    m_enabled = true;
+    m_maxTimeOut = 1000;
+}
+
+void ModbusTimeOuts::setEnabled(bool enabled)
+{
+    m_enabled = enabled;
+}
+
+void ModbusTimeOuts::setMaxTimeOut(int timeOut)
+{
+    m_maxTimeOut = qMax(1, timeOut);
+}
+
+void ModbusTimeOuts::clear()
+{
+    m_estimates.clear();
+}
+
+int ModbusTimeOuts::timeOut(int slave)
+{
+
+    //the configured timeout for the first request of a slave
+
+    if (!m_enabled || !m_estimates.contains(slave))
+        return m_maxTimeOut;
+
+    const Estimate &estimate = m_estimates[slave];
+    //a slave slower than the backed off timeout, or one that was offline,
+    //gets a chance to answer
+    if (estimate.silent > 0 && estimate.silent % ProbeInterval == 0)
+        return m_maxTimeOut;
+
+    int timeOut = MinTimeOut << MaxBackOff; //never answered
+    if (estimate.responded)
+        timeOut = (int)ceil(estimate.srtt + K * estimate.rttvar) << qMin(estimate.silent, (int)MaxBackOff);
+    return qMin(m_maxTimeOut, qMax((int)MinTimeOut, timeOut));
+
+}
+
+void ModbusTimeOuts::responded(int slave, double responseTime)
+{
+
+    Estimate &estimate = m_estimates[slave];
+    if (!estimate.responded) {
+        estimate.srtt = responseTime;
+        estimate.rttvar = responseTime / 2;
+        estimate.silent = 0;
+        estimate.responded = true;
+        return;
+    }
+
+    estimate.rttvar = 0.75 * estimate.rttvar + 0.25 * fabs(estimate.srtt - responseTime);
+    estimate.srtt = 0.875 * estimate.srtt + 0.125 * responseTime;
+    estimate.silent = 0;
+
+}
+
+void ModbusTimeOuts::expired(int slave)
+{
+
+    //slaves that never answered are counted too : offline from the start
+
+    Estimate &estimate = m_estimates[slave];
+    estimate.silent++;
+    if (estimate.silent == 1)
+        QLOG_TRACE() <<  "Slave " << slave << " timeout. Adaptive timeout = " << timeOut(slave) << " ms";
+
+}
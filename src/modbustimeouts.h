@@ -0,0 +1,44 @@
+#ifndef MODBUSTIMEOUTS_H
+#define MODBUSTIMEOUTS_H
+
+#include <QHash>
+
+//Response timeout of each slave, learned from its response times :
+//smoothed time + K * smoothed deviation (RFC 6298), bounded by the
+//configured timeout. A silent slave that answered before costs a few
+//times its usual response time instead of the configured timeout, one
+//that never answered costs MinTimeOut << MaxBackOff after its first miss.
+class ModbusTimeOuts
+{
+public:
+    ModbusTimeOuts();
+
+    enum {MinTimeOut = 30, //ms, scheduling and USB serial latency
+          K = 4,
+          MaxBackOff = 2, //timeout doubled at most twice while the slave is silent
+          ProbeInterval = 16}; //then one request of ProbeInterval waits the configured timeout
+
+    void setEnabled(bool enabled);
+    void setMaxTimeOut(int timeOut); //ms
+    void clear();
+    int timeOut(int slave); //ms
+    void responded(int slave, double responseTime); //ms, request sent to first byte
+    void expired(int slave);
+
+private:
+    struct Estimate
+    {
+        Estimate() : srtt(0), rttvar(0), silent(0), responded(false) {}
+
+        double srtt;
+        double rttvar;
+        int silent; //timeouts since the last response
+        bool responded; //srtt and rttvar are valid
+    };
+    QHash<int, Estimate> m_estimates; //slaves polled since the connection
+    bool m_enabled;
+    int m_maxTimeOut;
+
+};
+
+#endif // MODBUSTIMEOUTS_H
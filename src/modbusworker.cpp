@@ -0,0 +1,625 @@
+#include "modbusworker.h"
+#include "modbuspipeline.h"
+#include "modbusstatistics.h"
+
+#include "QsLog.h"
+#include <errno.h>
+
+//Results are posted to the GUI at display rate, the bus may be much slower
+static const int BatchInterval = 16;
+
+//Worker that is executing a request on the current thread (libmodbus callbacks)
+static thread_local ModbusWorker *t_worker = NULL;
+
+ModbusWorker::ModbusWorker(QObject *parent) :
+    QObject(parent),
+    m_modbus(NULL)
+{
+    m_connected = false;
+    m_tcp = false;
+    m_devicePort = 502;
+    m_deviceTimeOut = 0;
+    m_pipeline = new ModbusPipeline();
+    m_processScheduled = false;
+    m_busy = 0;
+    m_firstByte = 0;
+    m_statistics = NULL;
+    //setup memory for data - one PDU, large reads are split
+    dest = (uint8_t *) malloc(MODBUS_MAX_READ_BITS * sizeof(uint8_t));
+    memset(dest, 0, MODBUS_MAX_READ_BITS * sizeof(uint8_t));
+    dest16 = (uint16_t *) malloc(MODBUS_MAX_READ_REGISTERS * sizeof(uint16_t));
+    memset(dest16, 0, MODBUS_MAX_READ_REGISTERS * sizeof(uint16_t));
+}
+
+ModbusWorker::~ModbusWorker()
+{
+    disconnectDevice();
+    delete m_pipeline;
+    free(dest);
+    free(dest16);
+}
+
+int ModbusWorker::connectRTU(QString port, int baud, QChar parity, int dataBits, int stopBits, int RTS, int timeOut)
+{
+    //Modbus RTU connect - runs on the worker thread
+    disconnectDevice();
+
+    m_modbus = modbus_new_rtu(port.toLatin1().constData(),baud,parity.toLatin1(),dataBits,stopBits,RTS);
+
+    if(m_modbus == NULL){
+        return ContextError;
+    }
+
+    //Debug messages from libmodbus
+    #ifdef LIB_MODBUS_DEBUG_OUTPUT
+        modbus_set_debug(m_modbus, 1);
+    #endif
+
+    if(modbus_connect(m_modbus) == -1) {
+        modbus_free(m_modbus);
+        m_modbus = NULL;
+        return ConnectError;
+    }
+
+    #ifndef Q_OS_WIN32
+        //RS485 direction control : the kernel driver switches RTS at the end
+        //of the last stop bit, libmodbus toggles it when the port can't
+        if (RTS != MODBUS_RTU_RTS_NONE) {
+            modbus_rtu_set_rts(m_modbus, RTS);
+            if (modbus_rtu_set_serial_mode(m_modbus, MODBUS_RTU_RS485) == 0)
+                QLOG_INFO() <<  "RS485 kernel mode";
+            else
+                QLOG_INFO() <<  "RS485 kernel mode not supported. RTS toggled by libmodbus";
+        }
+    #endif
+
+    //error recovery mode
+    modbus_set_error_recovery(m_modbus, MODBUS_ERROR_RECOVERY_PROTOCOL);
+    //response_timeout - the bound of the timeouts learned for each slave
+    modbus_set_response_timeout(m_modbus, timeOut, 0);
+    m_timeOuts.setMaxTimeOut(timeOut * 1000);
+    m_timeOuts.clear();
+    m_connected = true;
+    m_tcp = false;
+
+    return ConnectOk;
+}
+
+int ModbusWorker::connectTCP(QString ip, int port, int timeOut)
+{
+    //Modbus TCP connect - runs on the worker thread
+    disconnectDevice();
+
+    m_modbus = modbus_new_tcp(ip.toLatin1().constData(), port);
+
+    if(m_modbus == NULL){
+        return ContextError;
+    }
+
+    //Debug messages from libmodbus
+    #ifdef LIB_MODBUS_DEBUG_OUTPUT
+        modbus_set_debug(m_modbus, 1);
+    #endif
+
+    if(modbus_connect(m_modbus) == -1) {
+        modbus_free(m_modbus);
+        m_modbus = NULL;
+        return ConnectError;
+    }
+
+    //error recovery mode
+    modbus_set_error_recovery(m_modbus, MODBUS_ERROR_RECOVERY_PROTOCOL);
+    //response_timeout - the bound of the timeouts learned for each slave
+    modbus_set_response_timeout(m_modbus, timeOut, 0);
+    m_timeOuts.setMaxTimeOut(timeOut * 1000);
+    m_timeOuts.clear();
+    m_connected = true;
+    m_tcp = true;
+
+    return ConnectOk;
+}
+
+void ModbusWorker::disconnectDevice()
+{
+    //Modbus disconnect - runs on the worker thread
+
+    if(m_modbus) {
+        if (m_connected)
+            modbus_close(m_modbus);
+        modbus_free(m_modbus);
+        m_modbus = NULL;
+    }
+
+    m_connected = false;
+
+}
+
+void ModbusWorker::enqueue(const ModbusRequest &request)
+{
+    QMutexLocker locker(&m_queueMutex);
+
+    m_queue.enqueue(request);
+    m_queue.last().queued = ModbusStatistics::now();
+    if (!m_processScheduled) {
+        m_processScheduled = true;
+        QMetaObject::invokeMethod(this, "processQueue", Qt::QueuedConnection);
+    }
+}
+
+void ModbusWorker::clearQueue()
+{
+    QMutexLocker locker(&m_queueMutex);
+
+    m_queue.clear();
+}
+
+int ModbusWorker::pending()
+{
+    QMutexLocker locker(&m_queueMutex);
+
+    return m_queue.size() + m_busy;
+}
+
+bool ModbusWorker::dequeue(ModbusRequest &request)
+{
+    QMutexLocker locker(&m_queueMutex);
+
+    if (m_queue.isEmpty()) {
+        m_processScheduled = false;
+        m_busy = 0;
+        return false;
+    }
+    request = m_queue.dequeue();
+    m_busy = 1;
+    return true;
+}
+
+bool ModbusWorker::takePipelined(ModbusRequest &request)
+{
+    QMutexLocker locker(&m_queueMutex);
+
+    //stop at the first request that needs a transaction of its own
+    if (m_queue.isEmpty() || !ModbusPipeline::canPipeline(m_queue.head()))
+        return false;
+    request = m_queue.dequeue();
+    m_busy = 1;
+    return true;
+}
+
+void ModbusWorker::setPipelineDepth(int depth)
+{
+    m_pipeline->setDepth(depth);
+}
+
+void ModbusWorker::setDevice(QString ip, int port, int timeOut)
+{
+    m_deviceIP = ip;
+    m_devicePort = port;
+    m_deviceTimeOut = timeOut;
+}
+
+void ModbusWorker::setAdaptiveTimeOut(bool adaptive)
+{
+    m_timeOuts.setEnabled(adaptive);
+}
+
+int ModbusWorker::responseTimeOut(int slave)
+{
+    return m_timeOuts.timeOut(slave);
+}
+
+void ModbusWorker::processQueue()
+{
+    //Drain the request queue - results are posted back in batches
+    ModbusRequest request;
+
+    m_batchTimer.start();
+    for (;;) {
+        if (m_tcp && m_modbus != NULL && m_pipeline->depth() > 1) {
+            //several TCP requests in flight
+            t_worker = this;
+            m_pipeline->run(m_modbus, this);
+            t_worker = NULL;
+        }
+        if (!dequeue(request))
+            break;
+        addResult(execute(request));
+    }
+
+    flushResults();
+
+}
+
+void ModbusWorker::addResult(const ModbusResult &result)
+{
+    if (m_statistics)
+        recordTiming(result);
+    learnTimeOut(result);
+    m_results.append(result);
+    if (m_batchTimer.elapsed() >= BatchInterval)
+        flushResults();
+}
+
+void ModbusWorker::flushResults()
+{
+    if (m_results.isEmpty())
+        return;
+    emit resultsReady(m_results);
+    m_results.clear();
+    m_batchTimer.restart();
+}
+
+ModbusResult ModbusWorker::execute(const ModbusRequest &request)
+{
+    ModbusResult result;
+
+    result.request = request;
+    if (m_modbus == NULL && !m_deviceIP.isEmpty()) {
+        //pooled device - (re)connect on demand
+        if (connectTCP(m_deviceIP, m_devicePort, m_deviceTimeOut) != ConnectOk) {
+            result.error = errno;
+            return result;
+        }
+    }
+    if (m_modbus == NULL) {
+        result.error = EINVAL;
+        return result;
+    }
+
+    t_worker = this;
+    m_frames.clear();
+    modbus_set_slave(m_modbus, request.slave);
+    const int timeOut = m_timeOuts.timeOut(request.slave);
+    modbus_set_response_timeout(m_modbus, timeOut / 1000, (timeOut % 1000) * 1000);
+    switch(request.functionCode)
+    {
+            case MODBUS_FC_READ_COILS:
+            case MODBUS_FC_READ_DISCRETE_INPUTS:
+            case MODBUS_FC_READ_HOLDING_REGISTERS:
+            case MODBUS_FC_READ_INPUT_REGISTERS:
+                    readData(request, result);
+                    break;
+
+            case MODBUS_FC_WRITE_SINGLE_COIL:
+            case MODBUS_FC_WRITE_SINGLE_REGISTER:
+            case MODBUS_FC_WRITE_MULTIPLE_COILS:
+            case MODBUS_FC_WRITE_MULTIPLE_REGISTERS:
+                    writeData(request, result);
+                    break;
+
+            case MODBUS_FC_WRITE_AND_READ_REGISTERS:
+                    writeReadData(request, result);
+                    break;
+
+            case MODBUS_FC_REPORT_SLAVE_ID:
+                    reportSlaveId(request, result);
+                    break;
+
+            default:
+                    result.error = EINVAL;
+                    break;
+    }
+    result.frames = m_frames;
+    t_worker = NULL;
+
+    if (result.ret < 0)
+        modbus_flush(m_modbus); //flush data
+
+    //pooled device - the next request reconnects
+    if (!m_deviceIP.isEmpty() &&
+        (result.error == ECONNRESET || result.error == EPIPE || result.error == EBADF))
+        disconnectDevice();
+
+    return result;
+}
+
+void ModbusWorker::readData(const ModbusRequest &request, ModbusResult &result)
+{
+
+    //Ranges larger than one PDU are read with back-to-back maximal requests
+    //and assembled in one contiguous result
+
+    int ret = -1; //return value from read functions
+    bool is16Bit = false;
+    int maxItems = MODBUS_MAX_READ_BITS;
+
+    if (request.functionCode == MODBUS_FC_READ_HOLDING_REGISTERS ||
+        request.functionCode == MODBUS_FC_READ_INPUT_REGISTERS) {
+        is16Bit = true;
+        maxItems = MODBUS_MAX_READ_REGISTERS;
+    }
+
+    if (request.noOfItems < 1 || request.startAddr < 0 ||
+        request.startAddr + request.noOfItems > MaxAddressSpace) {
+        result.error = EINVAL;
+        return;
+    }
+
+    result.data.resize(request.noOfItems);
+    int done = 0;
+    while (done < request.noOfItems) {
+        const int addr = request.startAddr + done;
+        const int noOfItems = qMin(maxItems, request.noOfItems - done);
+
+        //request data from modbus
+        switch(request.functionCode)
+        {
+                case MODBUS_FC_READ_COILS:
+                        ret = modbus_read_bits(m_modbus, addr, noOfItems, dest);
+                        break;
+
+                case MODBUS_FC_READ_DISCRETE_INPUTS:
+                        ret = modbus_read_input_bits(m_modbus, addr, noOfItems, dest);
+                        break;
+
+                case MODBUS_FC_READ_HOLDING_REGISTERS:
+                        ret = modbus_read_registers(m_modbus, addr, noOfItems, dest16);
+                        break;
+
+                case MODBUS_FC_READ_INPUT_REGISTERS:
+                        ret = modbus_read_input_registers(m_modbus, addr, noOfItems, dest16);
+                        break;
+
+                default:
+                        ret = -1;
+                        break;
+        }
+        result.error = errno;
+
+        QLOG_TRACE() <<  "Modbus Read Data return value = " << ret << ", errno = " << result.error;
+
+        if (ret > 0) {
+            for(int i = 0; i < ret; ++i)
+                result.data[done + i] = is16Bit ? dest16[i] : dest[i];
+            done += ret;
+        }
+        if (ret != noOfItems)
+            break;
+    }
+
+    //the whole range or the error of the failed request
+    if (ret < 0)
+        result.ret = ret;
+    else
+        result.ret = done;
+    result.data.resize(qMax(0, done));
+
+}
+
+void ModbusWorker::writeData(const ModbusRequest &request, ModbusResult &result)
+{
+
+    int ret = -1; //return value from functions
+    int noOfItems = qMin(request.noOfItems, request.values.size());
+
+    if (noOfItems < 1) {
+        result.error = EINVAL;
+        return;
+    }
+
+    //request data from modbus
+    switch(request.functionCode)
+    {
+            case MODBUS_FC_WRITE_SINGLE_COIL:
+                    ret = modbus_write_bit(m_modbus, request.startAddr, request.values[0]);
+                    break;
+
+            case MODBUS_FC_WRITE_SINGLE_REGISTER:
+                    ret = modbus_write_register(m_modbus, request.startAddr, request.values[0]);
+                    break;
+
+            case MODBUS_FC_WRITE_MULTIPLE_COILS:
+                    //the read buffer holds MODBUS_MAX_READ_BITS >= MODBUS_MAX_WRITE_BITS
+                    if (noOfItems > MODBUS_MAX_WRITE_BITS) {
+                            errno = EMBMDATA;
+                            break;
+                    }
+                    for(int i = 0; i < noOfItems; ++i)
+                    {
+                            dest[i] = request.values[i];
+                    }
+                    ret = modbus_write_bits(m_modbus, request.startAddr, noOfItems, dest);
+                    break;
+            case MODBUS_FC_WRITE_MULTIPLE_REGISTERS:
+                    ret = modbus_write_registers(m_modbus, request.startAddr, noOfItems, request.values.constData());
+                    break;
+
+            default:
+                    break;
+    }
+    result.error = errno;
+    result.ret = ret;
+
+    QLOG_TRACE() <<  "Modbus Write Data return value = " << ret << ", errno = " << result.error;
+
+    //read-after-write, in the same batch : no round trip through the GUI thread
+    if (request.verify && ret == noOfItems) {
+        ModbusRequest readBack = request;
+        readBack.functionCode = (request.functionCode == MODBUS_FC_WRITE_SINGLE_COIL ||
+                                 request.functionCode == MODBUS_FC_WRITE_MULTIPLE_COILS) ?
+                                MODBUS_FC_READ_COILS : MODBUS_FC_READ_HOLDING_REGISTERS;
+        readBack.noOfItems = noOfItems;
+        ModbusResult check;
+        readData(readBack, check);
+        result.data = check.data;
+        if (check.ret != noOfItems)
+            result.error = check.error;
+    }
+
+}
+
+void ModbusWorker::writeReadData(const ModbusRequest &request, ModbusResult &result)
+{
+
+    //Write then read holding registers in one transaction - a slave without
+    //FC 0x17 answers illegal function, the write and the read are sent apart
+
+    const int noOfWrites = request.values.size();
+
+    if (noOfWrites < 1 || noOfWrites > MODBUS_MAX_WR_WRITE_REGISTERS ||
+        request.noOfItems < 1 || request.noOfItems > MODBUS_MAX_WR_READ_REGISTERS) {
+        result.error = EINVAL;
+        return;
+    }
+
+    int ret = modbus_write_and_read_registers(m_modbus, request.writeAddr, noOfWrites, request.values.constData(),
+                                              request.startAddr, request.noOfItems, dest16);
+    result.error = errno;
+
+    QLOG_TRACE() <<  "Modbus Write and Read Data return value = " << ret << ", errno = " << result.error;
+
+    if (ret < 0 && result.error == EMBXILFUN) {
+        result.split = true;
+        ModbusRequest write = request;
+        write.functionCode = MODBUS_FC_WRITE_MULTIPLE_REGISTERS;
+        write.startAddr = request.writeAddr;
+        write.noOfItems = noOfWrites;
+        write.verify = false;
+        ModbusResult written;
+        writeData(write, written);
+        result.written = written.ret;
+        ModbusRequest read = request;
+        read.functionCode = MODBUS_FC_READ_HOLDING_REGISTERS;
+        readData(read, result);
+        if (written.ret < 0 && result.ret >= 0)
+            result.error = written.error;
+        return;
+    }
+
+    result.ret = ret;
+    result.written = ret < 0 ? ret : noOfWrites;
+    if (ret > 0) {
+        result.data.resize(ret);
+        for(int i = 0; i < ret; ++i)
+            result.data[i] = dest16[i];
+    }
+
+}
+
+void ModbusWorker::reportSlaveId(const ModbusRequest &request, ModbusResult &result)
+{
+
+    Q_UNUSED(request);
+
+    int ret = modbus_report_slave_id(m_modbus, MODBUS_MAX_PDU_LENGTH, dest);
+    result.error = errno;
+    result.ret = ret;
+
+    QLOG_TRACE() <<  "Modbus Report Slave ID return value = " << ret << ", errno = " << result.error;
+
+    if (ret > 0) {
+        result.data.resize(ret);
+        for(int i = 0; i < ret; ++i)
+            result.data[i] = dest[i];
+    }
+
+}
+
+void ModbusWorker::setStatistics(ModbusStatistics *statistics)
+{
+    m_statistics = statistics;
+}
+
+void ModbusWorker::recordTiming(const ModbusResult &result)
+{
+
+    //sent : first request frame, first byte and complete : first and last
+    //response frames - reads split in several PDUs span all of them
+
+    qint64 sent = 0;
+    qint64 firstByte = 0;
+    qint64 done = 0;
+    for (int i = 0; i < result.frames.size(); ++i) {
+        const ModbusFrame &frame = result.frames.at(i);
+        if (frame.direction == ModbusFrame::Tx) {
+            if (sent == 0)
+                sent = frame.elapsed;
+        }
+        else {
+            if (firstByte == 0)
+                firstByte = frame.firstByte;
+            done = frame.elapsed;
+        }
+    }
+
+    const ModbusRequest &request = result.request;
+    m_statistics->record(request.device, request.slave, request.functionCode, result.ret >= 0,
+                         request.queued, sent, firstByte, done);
+
+}
+
+void ModbusWorker::learnTimeOut(const ModbusResult &result)
+{
+
+    //response time of the first PDU : request handed to the port to the
+    //first byte of the response, the response timeout covers that wait
+
+    qint64 sent = 0;
+    for (int i = 0; i < result.frames.size(); ++i) {
+        const ModbusFrame &frame = result.frames.at(i);
+        if (frame.direction == ModbusFrame::Tx) {
+            if (sent == 0)
+                sent = frame.elapsed;
+        }
+        else if (sent > 0) {
+            const qint64 firstByte = frame.firstByte > 0 ? frame.firstByte : frame.elapsed;
+            m_timeOuts.responded(result.request.slave, (firstByte - sent) / 1000000.0);
+            return;
+        }
+    }
+
+    if (result.error == ETIMEDOUT)
+        m_timeOuts.expired(result.request.slave);
+
+}
+
+QList<ModbusFrame> ModbusWorker::takeFrames()
+{
+    QList<ModbusFrame> frames = m_frames;
+    m_frames.clear();
+    return frames;
+}
+
+void ModbusWorker::captureFirstByte()
+{
+    m_firstByte = ModbusStatistics::now();
+}
+
+void ModbusWorker::captureFrame(int direction, const uint8_t *data, int dataLen)
+{
+
+    ModbusFrame frame;
+
+    frame.time = QTime::currentTime();
+    frame.direction = direction;
+    frame.data = QByteArray((const char *)data, dataLen);
+    frame.elapsed = ModbusStatistics::now();
+    if (direction == ModbusFrame::Rx) {
+        frame.firstByte = m_firstByte;
+        m_firstByte = 0;
+    }
+    m_frames.append(frame);
+
+}
+
+extern "C" {
+
+void busMonitorRawResponseData(uint8_t * data, int dataLen)
+{
+        if (t_worker)
+            t_worker->captureFrame(ModbusFrame::Rx, data, dataLen);
+}
+
+void busMonitorRawResponseStart()
+{
+        if (t_worker)
+            t_worker->captureFirstByte();
+}
+
+void busMonitorRawRequestData(uint8_t * data, int dataLen)
+{
+        if (t_worker)
+            t_worker->captureFrame(ModbusFrame::Tx, data, dataLen);
+}
+
+}
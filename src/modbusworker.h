@@ -0,0 +1,141 @@
+#ifndef MODBUSWORKER_H
+#define MODBUSWORKER_H
+
+#include <QObject>
+#include <QQueue>
+#include <QMutex>
+#include <QList>
+#include <QVector>
+#include <QByteArray>
+#include <QTime>
+#include <QElapsedTimer>
+#include <QMetaType>
+#include "modbus.h"
+#include "modbustimeouts.h"
+
+//Number of addresses of each Modbus table - larger reads are split in PDUs
+static const int MaxAddressSpace = 65536;
+
+//Request posted to the worker thread
+struct ModbusRequest
+{
+    enum Origin {Poll = 0, Diagnostics = 1, Scan = 2};
+
+    ModbusRequest() : origin(Poll), tag(0), device(0), slave(0), functionCode(0),
+                      startAddr(0), noOfItems(0), writeAddr(0), verify(false), queued(0) {}
+
+    int origin;
+    int tag;
+    int device; //0 : the adapter connection, else a connection pool device
+    int slave;
+    int functionCode;
+    int startAddr;
+    int noOfItems;
+    int writeAddr; //FC 0x17 : first register written, start and count are the read
+    QVector<uint16_t> values; //values to write, one item per coil or register
+    bool verify; //write : read the items back in the result data
+    qint64 queued; //ModbusStatistics::now() when enqueued
+};
+
+//Raw frame captured from libmodbus while a request is executed
+struct ModbusFrame
+{
+    enum Direction {Tx = 0, Rx = 1};
+
+    ModbusFrame() : direction(Tx), elapsed(0), firstByte(0) {}
+
+    QTime time;
+    int direction;
+    QByteArray data;
+    qint64 elapsed; //ModbusStatistics::now() : Tx handed to the port, Rx complete
+    qint64 firstByte; //Rx : first byte taken from the port
+};
+
+//Outcome of a request, posted back to the GUI thread
+struct ModbusResult
+{
+    ModbusResult() : ret(-1), error(0), written(-1), split(false) {}
+
+    ModbusRequest request;
+    int ret;
+    int error; //errno after the libmodbus call
+    int written; //FC 0x17 : registers written, -1 on error
+    bool split; //FC 0x17 rejected by the slave : separate write and read
+    QVector<uint16_t> data; //values read, one item per coil or register
+    QList<ModbusFrame> frames;
+};
+
+Q_DECLARE_METATYPE(ModbusResult)
+
+class ModbusPipeline;
+class ModbusStatistics;
+
+class ModbusWorker : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ModbusWorker(QObject *parent = 0);
+    ~ModbusWorker();
+
+    enum ConnectStatus {ConnectOk = 0, ContextError, ConnectError};
+
+    //thread safe - may be called from any thread
+    void enqueue(const ModbusRequest &request);
+    void clearQueue();
+    int pending();
+
+    void captureFrame(int direction, const uint8_t *data, int dataLen);
+    void captureFirstByte();
+    void setStatistics(ModbusStatistics *statistics);
+
+    //worker thread only - used by the TCP pipeline
+    bool takePipelined(ModbusRequest &request);
+    void addResult(const ModbusResult &result);
+    QList<ModbusFrame> takeFrames();
+    int responseTimeOut(int slave); //ms
+
+public slots:
+    int connectRTU(QString port, int baud, QChar parity, int dataBits, int stopBits, int RTS, int timeOut);
+    int connectTCP(QString ip, int port, int timeOut);
+    void disconnectDevice();
+    void processQueue();
+    void setPipelineDepth(int depth);
+    void setDevice(QString ip, int port, int timeOut);
+    void setAdaptiveTimeOut(bool adaptive);
+
+signals:
+    void resultsReady(QList<ModbusResult> results);
+
+private:
+    bool dequeue(ModbusRequest &request);
+    void flushResults();
+    ModbusResult execute(const ModbusRequest &request);
+    void readData(const ModbusRequest &request, ModbusResult &result);
+    void writeData(const ModbusRequest &request, ModbusResult &result);
+    void writeReadData(const ModbusRequest &request, ModbusResult &result);
+    void reportSlaveId(const ModbusRequest &request, ModbusResult &result);
+    void recordTiming(const ModbusResult &result);
+    void learnTimeOut(const ModbusResult &result);
+    modbus_t *m_modbus;
+    bool m_connected;
+    bool m_tcp;
+    QString m_deviceIP; //pooled device, connected on demand
+    int m_devicePort;
+    int m_deviceTimeOut;
+    ModbusPipeline *m_pipeline;
+    QList<ModbusResult> m_results;
+    QElapsedTimer m_batchTimer;
+    QQueue<ModbusRequest> m_queue;
+    QMutex m_queueMutex;
+    bool m_processScheduled;
+    int m_busy;
+    QList<ModbusFrame> m_frames;
+    qint64 m_firstByte;
+    ModbusStatistics *m_statistics;
+    ModbusTimeOuts m_timeOuts;
+    uint8_t *dest;
+    uint16_t *dest16;
+
+};
+
+#endif // MODBUSWORKER_H
@@ -0,0 +1,115 @@
+#include "modbuswritequeue.h"
+
+#include "QsLog.h"
+
+ModbusWriteQueue::ModbusWriteQueue()
+{
+}
+
+qint64 ModbusWriteQueue::key(int slave, bool coils, int address)
+{
+    return ((qint64)(slave & 0xff) << 17) | ((coils ? 0 : 1) << 16) | (address & 0xffff);
+}
+
+int ModbusWriteQueue::maxItems(bool coils)
+{
+    return coils ? MODBUS_MAX_WRITE_BITS : MODBUS_MAX_WRITE_REGISTERS;
+}
+
+void ModbusWriteQueue::add(int slave, int functionCode, int address, uint16_t value)
+{
+    const bool coils = (functionCode == MODBUS_FC_WRITE_SINGLE_COIL ||
+                        functionCode == MODBUS_FC_WRITE_MULTIPLE_COILS);
+    m_pending.insert(key(slave, coils, address), value);
+}
+
+void ModbusWriteQueue::add(const ModbusRequest &request)
+{
+
+    //an edit made since the failed write is newer - keep it
+
+    const bool coils = (request.functionCode == MODBUS_FC_WRITE_SINGLE_COIL ||
+                        request.functionCode == MODBUS_FC_WRITE_MULTIPLE_COILS);
+    for (int i = 0; i < request.values.size(); ++i) {
+        const qint64 k = key(request.slave, coils, request.startAddr + i);
+        if (!m_pending.contains(k))
+            m_pending.insert(k, request.values.at(i));
+    }
+
+}
+
+void ModbusWriteQueue::clear()
+{
+    m_pending.clear();
+}
+
+int ModbusWriteQueue::count() const
+{
+    return m_pending.size();
+}
+
+QList<ModbusRequest> ModbusWriteQueue::take(bool verify)
+{
+
+    //FC 0x0F / 0x10 for the runs, FC 0x05 / 0x06 for the single items
+
+    QList<ModbusRequest> requests;
+    QMap<qint64, uint16_t>::const_iterator it = m_pending.constBegin();
+    while (it != m_pending.constEnd()) {
+        const qint64 first = it.key();
+        const bool coils = ((first >> 16) & 1) == 0;
+        const int max = maxItems(coils);
+
+        ModbusRequest request;
+        request.origin = ModbusRequest::Poll;
+        request.slave = (int)(first >> 17);
+        request.startAddr = (int)(first & 0xffff);
+        request.verify = verify;
+        request.values.reserve(max);
+        do {
+            request.values.append(it.value());
+            ++it;
+        } while (it != m_pending.constEnd() && it.key() == first + request.values.size() &&
+                 request.values.size() < max && (it.key() & 0xffff) != 0);
+
+        request.noOfItems = request.values.size();
+        if (coils)
+            request.functionCode = request.noOfItems > 1 ? MODBUS_FC_WRITE_MULTIPLE_COILS : MODBUS_FC_WRITE_SINGLE_COIL;
+        else
+            request.functionCode = request.noOfItems > 1 ? MODBUS_FC_WRITE_MULTIPLE_REGISTERS : MODBUS_FC_WRITE_SINGLE_REGISTER;
+        requests.append(request);
+    }
+
+    QLOG_TRACE() <<  "Write queue : " << m_pending.size() << " values in " << requests.size() << " requests";
+
+    m_pending.clear();
+    return requests;
+
+}
+
+bool ModbusWriteQueue::takeRegisters(int slave, int maxItems, ModbusRequest &request)
+{
+
+    //one FC 0x10 request, the rest of the queue is left for the next write
+
+    const qint64 first = key(slave, false, 0);
+    QMap<qint64, uint16_t>::iterator it = m_pending.lowerBound(first);
+    if (it == m_pending.end() || it.key() > first + 0xffff)
+        return false;
+
+    request = ModbusRequest();
+    request.origin = ModbusRequest::Poll;
+    request.slave = slave;
+    request.startAddr = (int)(it.key() & 0xffff);
+    const qint64 start = it.key();
+    do {
+        request.values.append(it.value());
+        it = m_pending.erase(it);
+    } while (it != m_pending.end() && it.key() == start + request.values.size() &&
+             request.values.size() < maxItems && (it.key() & 0xffff) != 0);
+
+    request.functionCode = MODBUS_FC_WRITE_MULTIPLE_REGISTERS;
+    request.noOfItems = request.values.size();
+    return true;
+
+}
@@ -0,0 +1,30 @@
+#ifndef MODBUSWRITEQUEUE_H
+#define MODBUSWRITEQUEUE_H
+
+#include <QMap>
+#include <QList>
+#include "modbusworker.h"
+
+//Values edited and not written yet, by slave, table and address
+//The last value of an address wins. take() returns the fewest write
+//requests : one per run of consecutive addresses, split at the PDU size
+class ModbusWriteQueue
+{
+public:
+    ModbusWriteQueue();
+
+    void add(int slave, int functionCode, int address, uint16_t value);
+    void add(const ModbusRequest &request); //the values of a failed write, to retry
+    void clear();
+    int count() const;
+    QList<ModbusRequest> take(bool verify);
+    bool takeRegisters(int slave, int maxItems, ModbusRequest &request); //first register run of the slave
+    static int maxItems(bool coils);
+
+private:
+    static qint64 key(int slave, bool coils, int address);
+    QMap<qint64, uint16_t> m_pending; //sorted : runs are consecutive keys
+
+};
+
+#endif // MODBUSWRITEQUEUE_H
@@ -1,25 +1,132 @@
 #include "rawdatamodel.h"
+#include "eutils.h"
 #include "QsLog.h"
 #include <QtDebug>
 
+static const int DefaultMaxNoOfLines = 60;
+
 RawDataModel::RawDataModel(QObject *parent) :
-    QObject(parent)
+    QAbstractListModel(parent)
 {
-    model = new  QStringListModel(this);
+    m_first = 0;
+    m_count = 0;
+    m_maxNoOfLines = DefaultMaxNoOfLines;
+    m_rawData.resize(m_maxNoOfLines);
     m_addLinesEnabled = false;
 }
 
+int RawDataModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : m_count;
+}
+
+QVariant RawDataModel::data(const QModelIndex &index, int role) const
+{
+
+    if (!index.isValid() || index.row() >= m_count)
+        return QVariant();
+
+    if (role == Qt::DisplayRole || role == Qt::EditRole)
+        return line(index.row());
+
+    return QVariant();
+
+}
+
 void RawDataModel::addLine(QString line)
 {
 
     if (!m_addLinesEnabled) return;
 
-    QLOG_TRACE() <<  "Raw Data Model Line = " << line << " , No of lines = " << m_rawData.length();
+    QLOG_TRACE() <<  "Raw Data Model Line = " << line << " , No of lines = " << m_count;
+
+    RawDataRecord record;
+    record.data = line.toUtf8();
+    addRecord(record);
+
+}
+
+void RawDataModel::addFrame(int type, int mode, const QTime &time, const QByteArray &data)
+{
+
+    if (!m_addLinesEnabled) return;
+
+    RawDataRecord record;
+    record.type = type;
+    record.mode = mode;
+    record.time = time;
+    record.data = data;
+    addRecord(record);
+
+}
+
+void RawDataModel::addRecord(const RawDataRecord &record)
+{
+
+    //evict the oldest line - only the first row is removed from the views
+    if (m_count == m_maxNoOfLines) {
+        beginRemoveRows(QModelIndex(), 0, 0);
+        m_rawData[m_first] = RawDataRecord();
+        m_first = (m_first + 1) % m_maxNoOfLines;
+        m_count--;
+        endRemoveRows();
+    }
+
+    beginInsertRows(QModelIndex(), m_count, m_count);
+    m_rawData[(m_first + m_count) % m_maxNoOfLines] = record;
+    m_count++;
+    endInsertRows();
 
-    if (m_rawData.length() == m_maxNoOfLines)
-        m_rawData.removeFirst();
-    m_rawData.append(line);
-    model->setStringList(m_rawData);
+}
+
+QString RawDataModel::line(int row) const
+{
+    return format(m_rawData.at((m_first + row) % m_maxNoOfLines));
+}
+
+QString RawDataModel::format(const RawDataRecord &record)
+{
+
+    //Text of a line - called for the visible rows only
+
+    switch (record.type) {
+        case RawDataRecord::Tx:
+            return EUtils::TxTimeStamp(record.mode, record.time) + " - " + toHex(record.data);
+        case RawDataRecord::Rx:
+            return EUtils::RxTimeStamp(record.mode, record.time) + " - " + toHex(record.data);
+        default:
+            return QString::fromUtf8(record.data);
+    }
+
+}
+
+QString RawDataModel::toHex(const QByteArray &data)
+{
+
+    //"0A  1B  ..." - the bus monitor parses the bytes separated by spaces
+    static const char digits[] = "0123456789ABCDEF";
+    QString hex(data.size() * 4, QChar(' '));
+    QChar *out = hex.data();
+
+    for (int i = 0; i < data.size(); ++i) {
+        const uchar b = (uchar)data.at(i);
+        out[i * 4] = QChar(digits[b >> 4]);
+        out[i * 4 + 1] = QChar(digits[b & 0xf]);
+    }
+
+    return hex;
+
+}
+
+QStringList RawDataModel::lines() const
+{
+
+    QStringList sl;
+
+    for (int i = 0; i < m_count; ++i)
+        sl.append(line(i));
+
+    return sl;
 
 }
 
@@ -28,14 +135,32 @@ void RawDataModel::clear()
 
     QLOG_TRACE() <<  "Raw Data Model cleared" ;
 
-    m_rawData.clear();
-    model->setStringList(m_rawData);
+    beginResetModel();
+    m_rawData.fill(RawDataRecord());
+    m_first = 0;
+    m_count = 0;
+    endResetModel();
 
 }
 
 void RawDataModel::setMaxNoOfLines(int noOfLines)
 {
+
+    if (noOfLines <= 0 || noOfLines == m_maxNoOfLines)
+        return;
+
+    //keep the newest lines that fit in the new capacity
+    beginResetModel();
+    QVector<RawDataRecord> records;
+    for (int i = qMax(0, m_count - noOfLines); i < m_count; ++i)
+        records.append(m_rawData.at((m_first + i) % m_maxNoOfLines));
+    m_first = 0;
+    m_count = records.size();
+    records.resize(noOfLines);
+    m_rawData = records;
     m_maxNoOfLines = noOfLines;
+    endResetModel();
+
 }
 
 void RawDataModel::enableAddLines(bool en)
@@ -2,27 +2,56 @@
 #define RAWDATAMODEL_H
 
 #include <QObject>
-#include <QStringListModel>
+#include <QAbstractListModel>
+#include <QVector>
+#include <QStringList>
+#include <QByteArray>
+#include <QTime>
+
+//Bus monitor line - frames are kept binary and formatted when displayed
+struct RawDataRecord
+{
+    enum Type {Sys = 0, Tx = 1, Rx = 2};
+
+    RawDataRecord() : type(Sys), mode(0) {}
 
-class RawDataModel : public QObject
+    QTime time;
+    qint8 type;
+    qint8 mode; //EUtils::RTU, EUtils::TCP
+    QByteArray data; //frame bytes, UTF-8 text of Sys lines
+};
+
+//Bus monitor lines kept in a fixed capacity ring buffer
+//The oldest line is evicted when the buffer is full
+class RawDataModel : public QAbstractListModel
 {
     Q_OBJECT
 public:
     explicit RawDataModel(QObject *parent = 0);
 
-    QStringListModel *model;
+    int rowCount(const QModelIndex &parent = QModelIndex()) const;
+    QVariant data(const QModelIndex &index, int role) const;
+
     void addLine(QString line);
+    void addFrame(int type, int mode, const QTime &time, const QByteArray &data);
+    QString line(int row) const;
+    QStringList lines() const;
     void enableAddLines(bool en);
     void clear();
     void setMaxNoOfLines(int noOfLines);
     int maxNoOfLines() { return m_maxNoOfLines; }
+    static QString toHex(const QByteArray &data);
 
 signals:
 
 public slots:
 
 private:
-    QStringList m_rawData;
+    void addRecord(const RawDataRecord &record);
+    static QString format(const RawDataRecord &record);
+    QVector<RawDataRecord> m_rawData; //ring buffer, capacity = max no of lines
+    int m_first; //index of the oldest line
+    int m_count;
     int m_maxNoOfLines;
     bool m_addLinesEnabled;
 
@@ -1,198 +1,378 @@
 #include "registersmodel.h"
 #include "QsLog.h"
-#include <QStandardItem>
+#include <QBrush>
 #include <QtDebug>
 
 #include "eutils.h"
 
+//time a changed value stays highlighted
+static const int HighlightTime = 500; //ms
+
 RegistersModel::RegistersModel(QObject *parent) :
-    QObject(parent)
+    QAbstractTableModel(parent)
 {
-   model = new  QStandardItemModel(0,0,this);
-   m_regDataDelegate = new RegistersDataDelegate(0);
+   m_regDataDelegate = NULL; //created with the view, not in headless mode
+   m_startAddress = 0;
    m_noOfItems = 0;
+   m_offset = 0;
+   m_firstRow = 0;
+   m_lastRow = 0;
+   m_valueIsEditable = false;
    m_is16Bit = false;
    m_isSigned = false;
    m_startAddrBase = 10;
+   m_frmt = EUtils::UInt;
+   m_highlightChanges = false;
+   m_highlightTimer = new QTimer(this);
+   m_highlightTimer->setSingleShot(true);
+   connect(m_highlightTimer,SIGNAL(timeout()),this,SLOT(clearHighlight()));
    clear();
 }
 
+int RegistersModel::rowCount(const QModelIndex &parent) const
+{
+
+    if (parent.isValid() || m_noOfItems == 0)
+        return 0;
+
+    return (m_noOfItems == 1 ? 1 : m_lastRow - m_firstRow + 1);
+
+}
+
+int RegistersModel::columnCount(const QModelIndex &parent) const
+{
+
+    if (parent.isValid() || m_noOfItems == 0)
+        return 0;
+
+    return (m_noOfItems == 1 ? 1 : RegModelColumns);
+
+}
+
+int RegistersModel::itemIndex(const QModelIndex &index) const
+{
+
+    //item of a cell, -1 for the not used cells
+
+    if (m_noOfItems == 1)
+        return 0;
+
+    int idx = index.row() * RegModelColumns + index.column() - m_offset;
+    if (idx < 0 || idx >= m_noOfItems)
+        return -1;
+
+    return idx;
+
+}
+
+QModelIndex RegistersModel::cellIndex(int idx) const
+{
+
+    if (m_noOfItems == 1)
+        return index(0, 0);
+
+    return index((m_offset + idx) / RegModelColumns, (m_offset + idx) % RegModelColumns);
+
+}
+
+QString RegistersModel::formatItem(int idx) const
+{
+
+    switch (m_status.at(idx)) {
+        case Valid:
+            return EUtils::formatValue(m_values.at(idx), m_frmt, m_is16Bit, m_isSigned);
+        case NotValid:
+            return "-/-";
+        default:
+            return "-";
+    }
+
+}
+
+QVariant RegistersModel::data(const QModelIndex &index, int role) const
+{
+
+    if (!index.isValid())
+        return QVariant();
+
+    const int idx = itemIndex(index);
+
+    switch (role) {
+        case Qt::DisplayRole:
+        case Qt::EditRole:
+            return (idx < 0 ? QString("x") : formatItem(idx));
+        case Qt::ForegroundRole:
+            if (idx < 0 || m_status.at(idx) == NotValid)
+                return QBrush(Qt::red);
+            if (m_status.at(idx) == Valid)
+                return QBrush(Qt::black);
+            break;
+        case Qt::BackgroundRole:
+            if (idx < 0)
+                return QBrush(Qt::lightGray);
+            if (m_changed.at(idx))
+                return QBrush(Qt::yellow);
+            break;
+        case Qt::ToolTipRole:
+            if (idx >= 0 && m_status.at(idx) == Valid)
+                return QString("Address : %1").arg(m_startAddress + idx, 1, m_startAddrBase).toUpper();
+            break;
+        default:
+            break;
+    }
+
+    return QVariant();
+
+}
+
+QVariant RegistersModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+
+    if (role != Qt::DisplayRole)
+        return QVariant();
+
+    if (orientation == Qt::Horizontal)
+        return (section < RegModelColumns ? RegModelHeaderLabels[section] : QString());
+    else if (m_noOfItems == 1)
+        return QString("%1").arg(m_startAddress, 2, 10, QLatin1Char('0'));
+    else
+        return QString("%1").arg((m_firstRow + section) * 10, 2, 10, QLatin1Char('0'));
+
+}
+
+Qt::ItemFlags RegistersModel::flags(const QModelIndex &index) const
+{
+
+    if (!index.isValid())
+        return Qt::NoItemFlags;
+
+    if (m_valueIsEditable && itemIndex(index) >= 0)
+        return Qt::ItemIsSelectable | Qt::ItemIsEnabled | Qt::ItemIsEditable;
+
+    return Qt::ItemIsSelectable | Qt::ItemIsEnabled;
+
+}
+
+bool RegistersModel::setData(const QModelIndex &index, const QVariant &value, int role)
+{
+
+    //value entered in the editor, as formatted by the delegate
+
+    const int idx = itemIndex(index);
+    if (role != Qt::EditRole || idx < 0)
+        return false;
+
+    bool ok;
+    int intVal = value.toString().toInt(&ok, m_frmt);
+    if (!ok)
+        return false;
+
+    m_values[idx] = (uint16_t)intVal;
+    m_status[idx] = Valid;
+    emit dataChanged(index, index);
+    emit valueEdited(idx);
+
+    return true;
+
+}
+
 void RegistersModel::addItems(int startAddress, int noOfItems, bool valueIsEditable)
 {
-    int row;
-    int col;
+
+    QLOG_TRACE() <<  "Registers Model Address = " << startAddress << " , noOfItems = " << noOfItems
+                << " , offset = " << (startAddress % 10) << " , first row = " << (startAddress / 10)
+                << " , last row = " << ((startAddress + noOfItems - 1) / 10);
+
+    beginResetModel();
     m_startAddress = startAddress;
-    m_noOfItems = noOfItems;
+    m_noOfItems = qMax(0, noOfItems);
     m_offset = (startAddress % 10);
     m_firstRow = startAddress / 10;
     m_lastRow = (startAddress + noOfItems - 1) / 10;
+    m_valueIsEditable = valueIsEditable;
+    m_values.fill(0, m_noOfItems);
+    m_status.fill(NoValue, m_noOfItems);
+    m_changed.fill(0, m_noOfItems);
+    endResetModel();
 
-    QLOG_TRACE() <<  "Registers Model Address = " << startAddress << " , noOfItems = " << noOfItems
-                << " , offset = " << m_offset << " , first row = " << m_firstRow << " , last row = " << m_lastRow;
-
-    //Format Vertical - Horizontal Header
-    clear();
-    if (noOfItems > 1) {
-        model->setHorizontalHeaderLabels(QStringList()<<RegModelHeaderLabels[0]<<RegModelHeaderLabels[1]
-                                                    <<RegModelHeaderLabels[2]<<RegModelHeaderLabels[3]
-                                                    <<RegModelHeaderLabels[4]<<RegModelHeaderLabels[5]
-                                                    <<RegModelHeaderLabels[6]<<RegModelHeaderLabels[7]
-                                                    <<RegModelHeaderLabels[8]<<RegModelHeaderLabels[9]);
-
-        QStringList vertHeader;
-        for (int i = m_firstRow; i <= m_lastRow ; i++) {
-            vertHeader<<QString("%1").arg(i * 10, 2, 10, QLatin1Char('0'));
-        }
-        model->setVerticalHeaderLabels(vertHeader);
-    }
-    else {
-        model->setHorizontalHeaderLabels(QStringList()<<RegModelHeaderLabels[0]);
-        model->setVerticalHeaderLabels(QStringList()<<QString("%1").arg(startAddress, 2, 10, QLatin1Char('0')));
-    }
+    emit(refreshView());
 
-    //Add data to model
-    if (noOfItems == 1){
-        QStandardItem *valueItem = new QStandardItem("-");model->setItem(0, 0, valueItem);
-        valueItem->setEditable(valueIsEditable);
-    }
-    else {
-        for (int i = 0; i < ((m_offset + noOfItems - 1) / 10 + 1) * 10 ; i++) {
-            row = i / 10;
-            col = i % 10;
-            //Address
-            if (i >= m_offset + noOfItems || i < m_offset){//not used cells
-                QStandardItem *valueItem = new QStandardItem("x");model->setItem(row, col, valueItem);
-                valueItem->setEditable(false);
-                valueItem->setForeground(QBrush(Qt::red));
-                valueItem->setBackground(QBrush(Qt::lightGray));
+}
+
+void RegistersModel::setNoValidValues()
+{
+
+    //if we have no valid values we set  as value = '-/-'
+
+    if (m_noOfItems == 0)
+        return;
+
+    m_status.fill(NotValid);
+    emitDataChanged(0, m_noOfItems - 1);
+    //the texts get wider
+    emit(refreshView());
+
+}
+
+void RegistersModel::setValue(int idx, int value)
+{
+
+    if (idx < 0 || idx >= m_noOfItems)
+        return;
+
+    m_values[idx] = (uint16_t)value;
+    m_status[idx] = Valid;
+    emitDataChanged(idx, idx);
+
+}
+
+void RegistersModel::setValues(const QVector<uint16_t> &values)
+{
+
+    //Compare with the previous values, only the changed spans are
+    //signaled to the views - static values cost no repaint
+
+    const int count = qMin(values.size(), m_noOfItems);
+    if (count == 0)
+        return;
+
+    const uint16_t *src = values.constData();
+    uint16_t *dst = m_values.data();
+    quint8 *status = m_status.data();
+    bool statusChanged = false;
+
+    //unchanged blocks are skipped with memcmp
+    static const int Block = 32;
+    int first = -1;
+    for (int i = 0; i < count; i += Block) {
+        const int n = qMin(Block, count - i);
+        bool blockValid = true;
+        for (int j = i; j < i + n && blockValid; ++j)
+            blockValid = (status[j] == Valid);
+        if (blockValid && memcmp(src + i, dst + i, n * sizeof(uint16_t)) == 0) {
+            if (first >= 0) {
+                itemsChanged(first, i - 1);
+                first = -1;
+            }
+            continue;
+        }
+        for (int j = i; j < i + n; ++j) {
+            if (src[j] != dst[j] || status[j] != Valid) {
+                if (status[j] != Valid)
+                    statusChanged = true;
+                dst[j] = src[j];
+                status[j] = Valid;
+                if (first < 0)
+                    first = j;
             }
-            else {
-                QStandardItem *valueItem = new QStandardItem("-");model->setItem(row, col, valueItem);
-                valueItem->setEditable(valueIsEditable);
+            else if (first >= 0) {
+                itemsChanged(first, j - 1);
+                first = -1;
             }
         }
     }
+    if (first >= 0)
+        itemsChanged(first, count - 1);
 
+    //new texts may be wider than '-'
+    if (statusChanged)
+        emit(refreshView());
 
-    emit(refreshView());
+    emit(valuesUpdated());
 
 }
 
-void RegistersModel::setNoValidValues()
+void RegistersModel::itemsChanged(int first, int last)
 {
 
-    int row;
-    int col;
-    //if we have no valid values we set  as value = '-/-'
-
-    for (int i = m_offset; i < m_offset + m_noOfItems; i++){
-        row = i / 10;
-        col = i % 10;
-        QModelIndex index = model->index(row, col, QModelIndex());
-        model->setData(index,QBrush(Qt::red),Qt::ForegroundRole);
-        model->setData(index,"-/-",Qt::DisplayRole);
+    if (m_highlightChanges) {
+        for (int i = first; i <= last; ++i)
+            m_changed[i] = 1;
+        m_highlightTimer->start(HighlightTime);
     }
 
+    emitDataChanged(first, last);
+
 }
 
-void RegistersModel::setValue(int idx, int value)
+void RegistersModel::emitDataChanged(int first, int last)
 {
-    int row;
-    int col;
-    QString convertedValue;
 
-    convertedValue = EUtils::formatValue(value, m_frmt, m_is16Bit, m_isSigned);
+    //a span of items may cover several rows
+    const QModelIndex topLeft = cellIndex(first);
+    const QModelIndex bottomRight = cellIndex(last);
 
-    //set model data
-    if (m_noOfItems == 1){
-        row = 0;
-        col = 0;
-    }
-    else {
-        row = (m_offset + idx) / 10;
-        col = (m_offset + idx) % 10;
-    }
+    if (topLeft.row() == bottomRight.row())
+        emit dataChanged(topLeft, bottomRight);
+    else
+        emit dataChanged(index(topLeft.row(), 0), index(bottomRight.row(), columnCount() - 1));
+
+}
+
+void RegistersModel::clearHighlight()
+{
+
+    int first = m_changed.indexOf(1);
+    if (first < 0)
+        return;
+
+    int last = m_changed.lastIndexOf(1);
+    m_changed.fill(0);
+    emitDataChanged(first, last);
+
+}
+
+void RegistersModel::setHighlightChanges(bool highlight)
+{
+
+    QLOG_TRACE()<<  "Registers Model highlight changes = " << highlight ;
+    m_highlightChanges = highlight;
+    if (!highlight)
+        clearHighlight();
 
-    QModelIndex index = model->index(row, col, QModelIndex());
-    model->setData(index,QBrush(Qt::black),Qt::ForegroundRole);
-    model->setData(index,convertedValue,Qt::DisplayRole);
-    model->setData(index,QString("Address : %1").arg(m_startAddress + idx, 1, m_startAddrBase).toUpper(),Qt::ToolTipRole);
 }
 
 int RegistersModel::value(int idx)
 {
-    QString stringVal;
-    int intVal;
-    bool ok;
 
-    //Get Value
-    stringVal = strValue(idx);
-    intVal = stringVal.toInt(&ok,m_base);
-    if (ok)
-        return intVal;
-    else
+    //raw value, -1 if the item has no value
+    if (idx < 0 || idx >= m_noOfItems || m_status.at(idx) != Valid)
         return -1;
 
+    return m_values.at(idx);
+
+}
+
+bool RegistersModel::isSigned()
+{
+    //16 bit values shown as signed
+    return m_is16Bit && m_isSigned;
+}
+
+int RegistersModel::itemAddress(int idx)
+{
+    return m_startAddress + idx;
 }
 
 QString RegistersModel::strValue(int idx)
 {
-    int row;
-    int col;
 
-    //get model data
-    if (m_noOfItems == 1){
-        row = 0;
-        col = 0;
-    }
-    else {
-        row = (m_offset + idx) / 10;
-        col = (m_offset + idx) % 10;
-    }
-    QModelIndex index = model->index(row, col, QModelIndex());
-    QVariant value = model->data(index,Qt::DisplayRole);
-    if (value.canConvert<QString>())
-        return value.toString();
-    else
+    if (idx < 0 || idx >= m_noOfItems)
         return "-/-";
 
+    return formatItem(idx);
+
 }
 
 void RegistersModel::changeBase(int frmt)
 {
 
-    QString stringVal;
-    int intVal;
-    int row;
-    int col;
-    bool ok;
-    QString convertedVal;
-
-    QLOG_TRACE()<<  "Registers Model changed base from " << m_base << " to " << frmt ;
-
-    //change base
-    for (int idx = 0; idx < m_noOfItems ; idx++) {
-        //Get Value
-        stringVal = strValue(idx);
-        intVal = stringVal.toInt(&ok,m_base);
-        //Format Value
-        if (ok)
-            convertedVal = EUtils::formatValue(intVal, frmt, m_is16Bit, m_isSigned);
-        else
-            convertedVal = "-/-";
-        //Update
-        if (m_noOfItems == 1){
-            row = 0;
-            col = 0;
-        }
-        else {
-            row = (m_offset + idx) / 10;
-            col = (m_offset + idx) % 10;
-        }
-        QModelIndex index = model->index(row, col, QModelIndex());
-        model->setData(index,convertedVal,Qt::DisplayRole);
-        model->setData(index,QString("Address : %1").arg(m_startAddress + idx, 1, m_startAddrBase).toUpper(),Qt::ToolTipRole);
-    }
+    QLOG_TRACE()<<  "Registers Model changed base from " << m_frmt << " to " << frmt ;
+
+    //values are stored raw, the views only need to fetch the text again
+    m_frmt = frmt;
+    if (m_noOfItems > 0)
+        emit dataChanged(index(0, 0), index(rowCount() - 1, columnCount() - 1));
 
     emit(refreshView());
 
@@ -204,7 +384,12 @@ void RegistersModel::clear()
     QLOG_TRACE()<<  "Registers Model Cleared" ;
 
     //Clear model
-    model->clear();
+    beginResetModel();
+    m_noOfItems = 0;
+    m_values.clear();
+    m_status.clear();
+    m_changed.clear();
+    endResetModel();
 
 }
 
@@ -222,10 +407,9 @@ void RegistersModel::setBase(int frmt)
 
     QLOG_TRACE()<<  "Registers Model set base = " << frmt ;
 
-    m_regDataDelegate->setBase(frmt);
+    if (m_regDataDelegate != NULL)
+        m_regDataDelegate->setBase(frmt);
     changeBase(frmt);
-    m_base = frmt;
-    m_frmt = frmt;
 
 }
 
@@ -234,7 +418,8 @@ void RegistersModel::setIs16Bit(bool is16Bit)
 
     QLOG_TRACE()<<  "Registers Model Is16Bit = " << is16Bit ;
     m_is16Bit = is16Bit;
-    m_regDataDelegate->setIs16Bit(is16Bit);
+    if (m_regDataDelegate != NULL)
+        m_regDataDelegate->setIs16Bit(is16Bit);
 
 }
 
@@ -243,7 +428,8 @@ void RegistersModel::setIsSigned(bool isSigned)
 
     QLOG_TRACE()<<  "Registers Model IsSigned = " << isSigned ;
     m_isSigned = isSigned;
-    m_regDataDelegate->setIsSigned(isSigned);
+    if (m_regDataDelegate != NULL)
+        m_regDataDelegate->setIsSigned(isSigned);
     changeBase(m_frmt);
 
 }
@@ -251,6 +437,13 @@ void RegistersModel::setIsSigned(bool isSigned)
 RegistersDataDelegate* RegistersModel::itemDelegate()
 {
 
+    if (m_regDataDelegate == NULL) {
+        m_regDataDelegate = new RegistersDataDelegate(0);
+        m_regDataDelegate->setBase(m_frmt);
+        m_regDataDelegate->setIs16Bit(m_is16Bit);
+        m_regDataDelegate->setIsSigned(m_isSigned);
+    }
+
     return m_regDataDelegate;
 
 }
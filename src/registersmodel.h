@@ -2,51 +2,82 @@
 #define REGISTERSMODEL_H
 
 #include <QObject>
-#include <QStandardItemModel>
+#include <QAbstractTableModel>
+#include <QVector>
+#include <QTimer>
 #include "registersdatadelegate.h"
 
 static const QString RegModelHeaderLabels[]={"00", "01", "02", "03", "04", "05", "06", "07", "08", "09"};
 static const int AddressColumn=0;
 static const int ValueColumn=1;
+static const int RegModelColumns=10;
 
-class RegistersModel : public QObject
+//Registers table - 10 items per row
+//Raw values are stored, the text is formatted for the visible cells only
+class RegistersModel : public QAbstractTableModel
 {
     Q_OBJECT
 public:
     explicit RegistersModel(QObject *parent = 0);
 
+    int rowCount(const QModelIndex &parent = QModelIndex()) const;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const;
+    QVariant data(const QModelIndex &index, int role) const;
+    QVariant headerData(int section, Qt::Orientation orientation, int role) const;
+    Qt::ItemFlags flags(const QModelIndex &index) const;
+    bool setData(const QModelIndex &index, const QVariant &value, int role);
+
     void addItems(int startAddress, int noOfItems, bool valueIsEditable);
     void setValue(int idx, int value);
+    void setValues(const QVector<uint16_t> &values);
     void setBase(int frmt);
     void setStartAddrBase(int base);
     void setIs16Bit(bool is16Bit);
     void setIsSigned(bool isSigned);
+    void setHighlightChanges(bool highlight);
     QString strValue(int idx);
     int value(int idx);
-    QStandardItemModel *model;
+    bool isSigned();
+    int itemIndex(const QModelIndex &index) const;
+    int itemAddress(int idx);
     void clear();
     void setNoValidValues();
     RegistersDataDelegate* itemDelegate();
 
 private:
+    enum ItemStatus {NoValue = 0, Valid, NotValid};
     void changeBase(int frmt);
+    QModelIndex cellIndex(int idx) const;
+    QString formatItem(int idx) const;
+    void itemsChanged(int first, int last);
+    void emitDataChanged(int first, int last);
+    QVector<uint16_t> m_values; //one item per coil or register
+    QVector<quint8> m_status;
+    QVector<quint8> m_changed; //items highlighted after a change
+    bool m_highlightChanges;
+    QTimer *m_highlightTimer;
     int m_startAddress;
     int m_noOfItems;
     int m_offset;
     int m_firstRow;
     int m_lastRow;
+    bool m_valueIsEditable;
     bool m_is16Bit;
     bool m_isSigned;
-    int m_base;
     int m_startAddrBase;
     int m_frmt;
     RegistersDataDelegate *m_regDataDelegate;
 
 signals:
     void refreshView();
+    void valuesUpdated(); //a poll result was stored, changed or not
+    void valueEdited(int idx); //value entered by the user
 
 public slots:
 
+private slots:
+    void clearHighlight();
+
 };
 
 #endif // REGISTERSMODEL_H
@@ -0,0 +1,131 @@
+#include "trendbuffer.h"
+
+TrendBuffer::TrendBuffer(int capacityBits)
+{
+    //room for at least one block of the highest level
+    capacityBits = qMax(capacityBits, (int)(LevelBits * Levels));
+    const int capacity = 1 << capacityBits;
+    m_mask = capacity - 1;
+    m_total = 0;
+    m_times.resize(capacity);
+    m_values.resize(capacity);
+    for (int level = 0; level < Levels; ++level) {
+        m_min[level].resize(capacity >> (LevelBits * (level + 1)));
+        m_max[level].resize(capacity >> (LevelBits * (level + 1)));
+    }
+}
+
+void TrendBuffer::clear()
+{
+    m_total = 0;
+}
+
+int TrendBuffer::count() const
+{
+    return (int)qMin(m_total, m_mask + 1);
+}
+
+void TrendBuffer::append(qint64 time, float value)
+{
+
+    //times must not go back for the binary search
+    if (m_total > 0 && time < m_times.at((m_total - 1) & m_mask))
+        time = m_times.at((m_total - 1) & m_mask);
+
+    const qint64 index = m_total;
+    m_times[index & m_mask] = time;
+    m_values[index & m_mask] = value;
+
+    //the first sample of a block resets its min and max
+    for (int level = 0; level < Levels; ++level) {
+        const int shift = LevelBits * (level + 1);
+        const int slot = (int)((index >> shift) & (m_min[level].size() - 1));
+        if ((index & ((Q_INT64_C(1) << shift) - 1)) == 0) {
+            m_min[level][slot] = value;
+            m_max[level][slot] = value;
+        }
+        else {
+            m_min[level][slot] = qMin(m_min[level].at(slot), value);
+            m_max[level][slot] = qMax(m_max[level].at(slot), value);
+        }
+    }
+
+    m_total++;
+
+}
+
+qint64 TrendBuffer::lowerBound(qint64 time) const
+{
+
+    //first kept sample at or after time
+
+    qint64 low = m_total - count();
+    qint64 high = m_total;
+    while (low < high) {
+        const qint64 middle = low + (high - low) / 2;
+        if (m_times.at(middle & m_mask) < time)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+
+    return low;
+
+}
+
+void TrendBuffer::range(qint64 first, qint64 last, float &min, float &max) const
+{
+
+    //samples [first, last) : the largest aligned block that fits, else one sample
+
+    qint64 index = first;
+    while (index < last) {
+        int level = Levels;
+        qint64 size = 1;
+        for (; level > 0; --level) {
+            size = Q_INT64_C(1) << (LevelBits * level);
+            if ((index & (size - 1)) == 0 && index + size <= last)
+                break;
+        }
+        if (level == 0) {
+            const float value = m_values.at(index & m_mask);
+            min = qMin(min, value);
+            max = qMax(max, value);
+            index++;
+        }
+        else {
+            const int slot = (int)((index >> (LevelBits * level)) & (m_min[level - 1].size() - 1));
+            min = qMin(min, m_min[level - 1].at(slot));
+            max = qMax(max, m_max[level - 1].at(slot));
+            index += size;
+        }
+    }
+
+}
+
+void TrendBuffer::decimate(qint64 from, qint64 to, int columns,
+                           QVector<float> &mins, QVector<float> &maxs, QVector<quint8> &has) const
+{
+
+    mins.resize(columns);
+    maxs.resize(columns);
+    has.fill(0, columns);
+    if (columns <= 0 || to <= from || m_total == 0)
+        return;
+
+    qint64 first = lowerBound(from);
+    for (int column = 0; column < columns; ++column) {
+        const qint64 end = from + (to - from) * (column + 1) / columns;
+        const qint64 last = lowerBound(end);
+        if (last > first) {
+            float min = m_values.at(first & m_mask);
+            float max = min;
+            range(first, last, min, max);
+            mins[column] = min;
+            maxs[column] = max;
+            has[column] = 1;
+        }
+        first = last;
+    }
+
+}
@@ -0,0 +1,36 @@
+#ifndef TRENDBUFFER_H
+#define TRENDBUFFER_H
+
+#include <QVector>
+
+//Ring buffer of (time, value) samples of one trend series
+//Min and max of blocks of 16, 256 and 4096 samples are kept next to the
+//samples : the min/max of any range costs a few dozen reads, so a plot
+//column costs the same whatever the history length
+class TrendBuffer
+{
+public:
+    explicit TrendBuffer(int capacityBits = 16);
+
+    enum {LevelBits = 4, Levels = 3};
+
+    void append(qint64 time, float value);
+    void clear();
+    int count() const;
+    //min and max per column of [from, to), has[c] = 0 for the columns without samples
+    void decimate(qint64 from, qint64 to, int columns,
+                  QVector<float> &mins, QVector<float> &maxs, QVector<quint8> &has) const;
+
+private:
+    qint64 lowerBound(qint64 time) const;
+    void range(qint64 first, qint64 last, float &min, float &max) const;
+    qint64 m_mask;
+    qint64 m_total; //samples appended, the last count() are kept
+    QVector<qint64> m_times;
+    QVector<float> m_values;
+    QVector<float> m_min[Levels];
+    QVector<float> m_max[Levels];
+
+};
+
+#endif // TRENDBUFFER_H
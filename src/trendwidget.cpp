@@ -0,0 +1,184 @@
+#include "trendwidget.h"
+
+#include <QPainter>
+#include <QPolygonF>
+#include <QDateTime>
+
+//repaints per second, whatever the poll rate
+static const int RefreshRate = 25;
+//poll rate the history is sized for - faster polls keep a shorter history
+static const int MaxSampleRate = 100;
+static const Qt::GlobalColor Colors[] = {Qt::blue, Qt::red, Qt::darkGreen, Qt::magenta, Qt::darkCyan,
+                                         Qt::darkYellow, Qt::black, Qt::darkRed, Qt::darkBlue, Qt::darkMagenta};
+static const int NoOfColors = sizeof(Colors) / sizeof(Colors[0]);
+//plot margins for the axis labels
+static const int LeftMargin = 60;
+static const int Margin = 8;
+static const int BottomMargin = 20;
+
+TrendWidget::TrendWidget(QWidget *parent) :
+    QWidget(parent)
+{
+    m_span = 60000;
+    m_capacityBits = 16;
+    m_dirty = false;
+    setAutoFillBackground(true);
+    setPalette(QPalette(Qt::white));
+    setMinimumSize(300, 150);
+    m_refreshTimer = new QTimer(this);
+    connect(m_refreshTimer,SIGNAL(timeout()),this,SLOT(refresh()));
+    m_refreshTimer->start(1000 / RefreshRate);
+}
+
+TrendWidget::~TrendWidget()
+{
+    clear();
+}
+
+int TrendWidget::addSeries(const QString &name)
+{
+    Series series;
+    series.name = name;
+    series.color = QColor(Colors[m_series.size() % NoOfColors]);
+    series.buffer = new TrendBuffer(m_capacityBits);
+    m_series.append(series);
+    m_dirty = true;
+    return m_series.size() - 1;
+}
+
+void TrendWidget::setMaxSpan(int span)
+{
+
+    //smallest power of two that holds span at MaxSampleRate
+
+    const qint64 samples = (qint64)span * MaxSampleRate / 1000;
+    m_capacityBits = 1;
+    while (((qint64)1 << m_capacityBits) < samples)
+        m_capacityBits++;
+
+}
+
+void TrendWidget::append(int series, qint64 time, float value)
+{
+    if (series < 0 || series >= m_series.size())
+        return;
+    m_series.at(series).buffer->append(time, value);
+    m_dirty = true;
+}
+
+void TrendWidget::clear()
+{
+    for (int i = 0; i < m_series.size(); ++i)
+        delete m_series.at(i).buffer;
+    m_series.clear();
+    m_dirty = true;
+}
+
+int TrendWidget::count()
+{
+    return m_series.size();
+}
+
+void TrendWidget::setSpan(int span)
+{
+    m_span = qMax(1000, span);
+    m_dirty = true;
+}
+
+void TrendWidget::refresh()
+{
+
+    //the plot scrolls : repaint while there are series
+
+    if (m_dirty || !m_series.isEmpty())
+        update();
+    m_dirty = false;
+
+}
+
+void TrendWidget::paintEvent(QPaintEvent *event)
+{
+
+    //One min/max pair per pixel column and series - the cost depends on
+    //the widget width, not on the number of samples
+
+    Q_UNUSED(event);
+
+    QPainter painter(this);
+    const QRect plot = rect().adjusted(LeftMargin, Margin, -Margin, -BottomMargin);
+    if (plot.width() < 2 || plot.height() < 2)
+        return;
+
+    const qint64 to = QDateTime::currentMSecsSinceEpoch();
+    const qint64 from = to - m_span;
+    const int columns = plot.width();
+
+    //decimate and find the value range
+    QVector<QVector<float> > mins(m_series.size());
+    QVector<QVector<float> > maxs(m_series.size());
+    QVector<QVector<quint8> > has(m_series.size());
+    float low = 0;
+    float high = 0;
+    bool empty = true;
+    for (int i = 0; i < m_series.size(); ++i) {
+        m_series.at(i).buffer->decimate(from, to, columns, mins[i], maxs[i], has[i]);
+        for (int c = 0; c < columns; ++c) {
+            if (!has[i].at(c))
+                continue;
+            if (empty || mins[i].at(c) < low)
+                low = mins[i].at(c);
+            if (empty || maxs[i].at(c) > high)
+                high = maxs[i].at(c);
+            empty = false;
+        }
+    }
+    if (high - low < 1) {
+        low -= 0.5;
+        high += 0.5;
+    }
+    const double scale = plot.height() / (double)(high - low);
+
+    //grid and labels
+    painter.setPen(Qt::lightGray);
+    for (int i = 0; i <= 4; ++i) {
+        const int y = plot.bottom() - i * plot.height() / 4;
+        painter.drawLine(plot.left(), y, plot.right(), y);
+        painter.setPen(Qt::black);
+        painter.drawText(QRect(0, y - 10, LeftMargin - 4, 20), Qt::AlignRight | Qt::AlignVCenter,
+                         QString::number(low + (high - low) * i / 4.0, 'g', 6));
+        painter.setPen(Qt::lightGray);
+    }
+    painter.setPen(Qt::black);
+    painter.drawRect(plot);
+    painter.drawText(QRect(plot.left(), plot.bottom(), plot.width(), BottomMargin), Qt::AlignLeft | Qt::AlignVCenter,
+                     QString("-%1 s").arg(m_span / 1000));
+    painter.drawText(QRect(plot.left(), plot.bottom(), plot.width(), BottomMargin), Qt::AlignRight | Qt::AlignVCenter,
+                     tr("now"));
+
+    //series : the column min and max joined by one polyline
+    painter.setClipRect(plot.adjusted(0, 0, 1, 1));
+    for (int i = 0; i < m_series.size(); ++i) {
+        QPolygonF line;
+        line.reserve(2 * columns);
+        for (int c = 0; c < columns; ++c) {
+            if (!has[i].at(c))
+                continue;
+            const double x = plot.left() + c;
+            line.append(QPointF(x, plot.bottom() - (maxs[i].at(c) - low) * scale));
+            if (mins[i].at(c) != maxs[i].at(c))
+                line.append(QPointF(x, plot.bottom() - (mins[i].at(c) - low) * scale));
+        }
+        painter.setPen(m_series.at(i).color);
+        painter.drawPolyline(line);
+    }
+    painter.setClipping(false);
+
+    //legend
+    int x = plot.left() + 4;
+    for (int i = 0; i < m_series.size(); ++i) {
+        painter.setPen(m_series.at(i).color);
+        painter.drawText(x, plot.top() + 14, m_series.at(i).name);
+        x += painter.fontMetrics().width(m_series.at(i).name) + 12;
+    }
+
+}
@@ -0,0 +1,47 @@
+#ifndef TRENDWIDGET_H
+#define TRENDWIDGET_H
+
+#include <QWidget>
+#include <QList>
+#include <QColor>
+#include <QTimer>
+#include "trendbuffer.h"
+
+//Scrolling plot of trend series - samples are appended at poll rate,
+//the widget repaints at most RefreshRate times per second
+class TrendWidget : public QWidget
+{
+    Q_OBJECT
+public:
+    explicit TrendWidget(QWidget *parent = 0);
+    ~TrendWidget();
+
+    int addSeries(const QString &name);
+    void append(int series, qint64 time, float value);
+    void clear();
+    int count();
+    void setSpan(int span);
+    void setMaxSpan(int span); //history kept by the series added afterwards
+
+protected:
+    void paintEvent(QPaintEvent *event);
+
+private:
+    struct Series
+    {
+        QString name;
+        QColor color;
+        TrendBuffer *buffer;
+    };
+    QList<Series> m_series;
+    int m_span; //ms
+    int m_capacityBits; //samples kept per series
+    bool m_dirty;
+    QTimer *m_refreshTimer;
+
+private slots:
+    void refresh();
+
+};
+
+#endif // TRENDWIDGET_H